@@ -0,0 +1,328 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/callgraph>
+#include <ipr/traversal>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+namespace ipr {
+   namespace {
+      // The declaration that designates the decl-set of a function.
+      const ipr::Fundecl&
+      master(const ipr::Fundecl& f)
+      {
+         try {
+            const ipr::Decl& d = f.master();
+            if (d.category == fundecl_cat)
+               return static_cast<const ipr::Fundecl&>(d);
+         }
+         catch (const std::logic_error&) {
+         }
+         return f;
+      }
+
+      const ipr::Fundecl*
+      as_function(const ipr::Expr& x)
+      {
+         if (x.category != fundecl_cat)
+            return nullptr;
+         return &master(static_cast<const ipr::Fundecl&>(x));
+      }
+
+      // The function a call designates, if known.  Names that are not
+      // resolved yet designate nothing.
+      const ipr::Fundecl*
+      callee(const ipr::Call& c)
+      {
+         try {
+            if (const Optional<Decl> d = c.implementation())
+               if (const ipr::Fundecl* f = as_function(d.get()))
+                  return f;
+            const ipr::Expr& fun = c.function();
+            if (fun.category == id_expr_cat)
+               return as_function
+                  (static_cast<const ipr::Id_expr&>(fun).resolution());
+         }
+         catch (const std::logic_error&) {
+         }
+         return nullptr;
+      }
+
+      // The body of the definition of a function, if any.
+      const ipr::Expr*
+      body(const ipr::Fundecl& f)
+      {
+         try {
+            if (const Optional<Expr> x = f.initializer())
+               return &x.get();
+         }
+         catch (const std::logic_error&) {
+         }
+         return nullptr;
+      }
+
+      struct Call_site {
+         int caller;
+         const ipr::Fundecl* callee;
+      };
+
+      // The calls found by one thread.  Nodes of a body are entered
+      // once; the marks are undone after each body, as bodies may share
+      // nodes.
+      struct Scanner {
+         std::vector<Call_site> calls;
+         std::vector<const ipr::Node*> stack;
+         std::vector<const ipr::Node*> marked;
+         Node_set seen;
+
+         void scan(int caller, const ipr::Expr& x)
+         {
+            auto reach = [this](const ipr::Node& n) {
+               if (seen.insert(n)) {
+                  marked.push_back(&n);
+                  stack.push_back(&n);
+               }
+            };
+            reach(x);
+            while (not stack.empty()) {
+               const ipr::Node& n = *stack.back();
+               stack.pop_back();
+               if (n.category == call_cat) {
+                  if (const ipr::Fundecl* f =
+                      callee(static_cast<const ipr::Call&>(n)))
+                     calls.push_back({ caller, f });
+               }
+               // The bodies of other functions are theirs; types and
+               // names evaluate nothing.
+               else if (n.category == fundecl_cat
+                        or (n.category >= type_cat
+                            and n.category <= rname_cat))
+                  continue;
+               for_each_operand(n, reach);
+            }
+            for (auto p : marked)
+               seen.erase(*p);
+            marked.clear();
+         }
+      };
+   }
+
+   // Functions are gathered from the scopes of the unit, then their
+   // bodies are scanned by threads that each take the next batch of
+   // functions not yet taken.  Callees found in no scope are numbered
+   // after, in the order of their callers.
+   Call_graph::Call_graph(const ipr::Translation_unit& unit,
+                          const Options& options)
+   {
+      struct Definition {
+         int caller;
+         const ipr::Expr* body;
+      };
+      std::vector<Definition> definitions;
+      auto add = [this](const ipr::Fundecl& f) {
+         int& i = indices[f];
+         if (i < 0) {
+            i = functions.size();
+            functions.push_back(&f);
+         }
+         return i;
+      };
+
+      for_each_scope(unit.global_namespace().scope(),
+                     [&](const ipr::Scope& s) {
+            for (auto& d : s.members())
+               if (d.category == fundecl_cat) {
+                  const ipr::Fundecl& f = static_cast<const ipr::Fundecl&>(d);
+                  const int i = add(master(f));
+                  if (const ipr::Expr* x = body(f))
+                     definitions.push_back({ i, x });
+               }
+         });
+
+      const int n = definitions.size();
+      int threads = options.threads > 0 ? options.threads
+         : int(std::thread::hardware_concurrency());
+      threads = std::max(1, std::min(threads, n));
+      std::vector<Scanner> scanners(threads);
+      if (threads == 1)
+         for (auto& d : definitions)
+            scanners[0].scan(d.caller, *d.body);
+      else {
+         const int batch = 16;
+         std::atomic<int> next { 0 };
+         std::vector<std::exception_ptr> errors(threads);
+         std::vector<std::thread> workers;
+         for (int i = 0; i < threads; ++i)
+            workers.emplace_back([&, i] {
+                  try {
+                     for (int k = next.fetch_add(batch); k < n;
+                          k = next.fetch_add(batch))
+                        for (int j = k; j < std::min(k + batch, n); ++j)
+                           scanners[i].scan(definitions[j].caller,
+                                            *definitions[j].body);
+                  }
+                  catch (...) {
+                     errors[i] = std::current_exception();
+                  }
+               });
+         for (auto& t : workers)
+            t.join();
+         for (auto& e : errors)
+            if (e)
+               std::rethrow_exception(e);
+      }
+
+      // Number the callees, count the calls of each caller, then place
+      // the callees of each caller in its row.
+      std::size_t total = 0;
+      std::vector<int> callers;
+      std::vector<int> targets;
+      for (auto& s : scanners)
+         total += s.calls.size();
+      callers.reserve(total);
+      targets.reserve(total);
+      for (auto& s : scanners) {
+         for (auto& c : s.calls) {
+            callers.push_back(c.caller);
+            targets.push_back(add(*c.callee));
+         }
+         s.calls.clear();
+         s.calls.shrink_to_fit();
+      }
+
+      edge_starts.assign(functions.size() + 1, 0);
+      for (int c : callers)
+         ++edge_starts[c + 1];
+      for (std::size_t i = 0; i < functions.size(); ++i)
+         edge_starts[i + 1] += edge_starts[i];
+      edges.resize(total);
+      std::vector<int> fill(edge_starts.begin(), edge_starts.end() - 1);
+      for (std::size_t j = 0; j < total; ++j)
+         edges[fill[callers[j]]++] = targets[j];
+
+      // Sort the callees of each caller, and drop repetitions.
+      int out = 0;
+      for (std::size_t i = 0; i < functions.size(); ++i) {
+         const auto first = edges.begin() + edge_starts[i];
+         const auto last = edges.begin() + edge_starts[i + 1];
+         std::sort(first, last);
+         edge_starts[i] = out;
+         out = std::unique_copy(first, last, edges.begin() + out)
+            - edges.begin();
+      }
+      edge_starts.back() = out;
+      edges.resize(out);
+      edges.shrink_to_fit();
+
+      condense();
+   }
+
+   // Tarjan's algorithm, without recursion.  A component is complete
+   // only once all the components it reaches are, which numbers them
+   // bottom up.
+   void
+   Call_graph::condense()
+   {
+      const int n = functions.size();
+      std::vector<int> order(n, -1);   // when each function was reached
+      std::vector<int> low(n);
+      std::vector<int> pending;         // reached, not yet in a component
+      std::vector<bool> on_pending(n);
+      struct Frame {
+         int node;
+         int next;                      // next callee to visit
+      };
+      std::vector<Frame> stack;
+      int reached = 0;
+      components.assign(n, -1);
+      component_starts.assign(1, 0);
+      component_members.clear();
+      component_members.reserve(n);
+
+      for (int root = 0; root < n; ++root) {
+         if (order[root] >= 0)
+            continue;
+         stack.push_back({ root, edge_starts[root] });
+         order[root] = low[root] = reached++;
+         pending.push_back(root);
+         on_pending[root] = true;
+         while (not stack.empty()) {
+            Frame& top = stack.back();
+            const int v = top.node;
+            if (top.next < edge_starts[v + 1]) {
+               const int w = edges[top.next++];
+               if (order[w] < 0) {
+                  order[w] = low[w] = reached++;
+                  pending.push_back(w);
+                  on_pending[w] = true;
+                  stack.push_back({ w, edge_starts[w] });
+               }
+               else if (on_pending[w])
+                  low[v] = std::min(low[v], order[w]);
+               continue;
+            }
+            stack.pop_back();
+            if (not stack.empty())
+               low[stack.back().node] =
+                  std::min(low[stack.back().node], low[v]);
+            if (low[v] != order[v])
+               continue;
+            const int c = component_starts.size() - 1;
+            const std::size_t first = component_members.size();
+            int w;
+            do {
+               w = pending.back();
+               pending.pop_back();
+               on_pending[w] = false;
+               components[w] = c;
+               component_members.push_back(w);
+            } while (w != v);
+            std::sort(component_members.begin() + first,
+                      component_members.end());
+            component_starts.push_back(component_members.size());
+         }
+      }
+   }
+
+   int
+   Call_graph::index(const ipr::Decl& d) const
+   {
+      if (d.category != fundecl_cat)
+         return -1;
+      return indices(master(static_cast<const ipr::Fundecl&>(d)));
+   }
+
+   Call_graph::Range
+   Call_graph::callees(int i) const
+   {
+      if (i < 0 or i >= size())
+         throw std::domain_error("ipr::Call_graph: no such function");
+      return { edges.data() + edge_starts[i],
+               edges.data() + edge_starts[i + 1] };
+   }
+
+   Call_graph::Range
+   Call_graph::members(int c) const
+   {
+      if (c < 0 or c >= component_count())
+         throw std::domain_error("ipr::Call_graph: no such component");
+      return { component_members.data() + component_starts[c],
+               component_members.data() + component_starts[c + 1] };
+   }
+
+   bool
+   Call_graph::recursive(int i) const
+   {
+      const Range r = callees(i);
+      const int c = components[i];
+      return component_starts[c + 1] - component_starts[c] > 1
+         or std::binary_search(r.first, r.second, i);
+   }
+}
@@ -0,0 +1,359 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/diff>
+#include <ipr/traversal>
+#include <ipr/io>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace ipr {
+   namespace diff {
+      namespace {
+         using Hash = Hasher::Hash;
+
+         inline Hash
+         mix(Hash h, Hash v)
+         {
+            return h ^ (v + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2));
+         }
+
+         // The name of a user-defined type, or null if it is unnamed.
+         const ipr::Name*
+         name_of(const ipr::Udt& t)
+         {
+            try {
+               return &t.name();
+            }
+            catch (const std::logic_error&) {
+               return nullptr;
+            }
+         }
+
+      }
+
+      Hash
+      Hasher::operator()(const ipr::Node& n)
+      {
+         // A node under evaluation hashes as 0 in its own operands.
+         if (not seen.insert(n))
+            return memo(n);
+
+         Hash h = Hash(n.category) * 0x100000001b3;
+         if (n.category == string_cat) {
+            const String& s = static_cast<const String&>(n);
+            for (auto c : s)
+               h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+         }
+         else if (is_udt(n.category)) {
+            const ipr::Udt& t = static_cast<const ipr::Udt&>(n);
+            if (auto id = name_of(t))
+               h = mix(h, (*this)(*id));
+            else
+               h = mix(h, members(t));  // unnamed: known by its members
+         }
+         else if (is_decl(n.category))
+            h = decl(static_cast<const ipr::Decl&>(n));
+         else
+            for_each_operand(n, [&](const Node& x) { h = mix(h, (*this)(x)); });
+
+         return memo[n] = h;
+      }
+
+      Hash
+      Hasher::members(const ipr::Udt& t)
+      {
+         // Member hashes are memoized against the region of the type,
+         // a node that is otherwise never hashed.
+         const ipr::Node& key = t.region();
+         if (not seen.insert(key))
+            return memo(key);
+
+         Hash h = Hash(t.category);
+         if (t.category == class_cat)
+            for (auto& b : static_cast<const ipr::Class&>(t).bases())
+               h = mix(h, (*this)(b));
+         for (auto& d : t.scope().members())
+            h = mix(h, (*this)(d));
+
+         return memo[key] = h;
+      }
+
+      Hash
+      Hasher::decl(const ipr::Decl& d)
+      {
+         Hash h = mix(Hash(d.category) * 0x100000001b3,
+                      Hash(d.specifiers()));
+         const ipr::Udt* udt = defined_udt(d);
+         for_each_operand(d, [&](const Node& x) {
+               if (&x == udt)
+                  h = mix(h, members(*udt));
+               else
+                  h = mix(h, (*this)(x));
+            });
+         return h;
+      }
+
+      namespace {
+         // The text used to match declarations by name.
+         std::string
+         text(const ipr::Decl& d)
+         {
+            if (d.category == asm_cat)
+               return "asm";
+            const ipr::Name& n = d.name();
+            if (n.category == identifier_cat) {
+               const String& s = static_cast<const Identifier&>(n).string();
+               return { s.begin(), s.end() };
+            }
+            std::ostringstream os;
+            Printer pp { os };
+            pp << xpr_expr(n);
+            return os.str();
+         }
+
+         struct Comparer {
+            Hasher hash;
+            Report report;
+
+            void entry(Change k, const std::string& name,
+                       const ipr::Decl* a, const ipr::Decl* b,
+                       const ipr::Node* x, const ipr::Node* y)
+            {
+               report.entries.push_back({ k, name, a, b, x, y });
+            }
+
+            // Descend from a pair of nodes with different hashes to
+            // the innermost pair of expressions that still differ.
+            std::pair<const ipr::Node*, const ipr::Node*>
+            difference(const ipr::Node& a, const ipr::Node& b)
+            {
+               std::pair<const ipr::Node*, const ipr::Node*> last { &a, &b };
+               const ipr::Node* x = &a;
+               const ipr::Node* y = &b;
+               std::vector<const ipr::Node*> xs;
+               std::vector<const ipr::Node*> ys;
+               while (x->category == y->category and not is_udt(x->category)) {
+                  if (x->category > expr_cat)
+                     last = { x, y };
+                  xs.clear();
+                  ys.clear();
+                  for_each_operand(*x, [&](const Node& n) { xs.push_back(&n); });
+                  for_each_operand(*y, [&](const Node& n) { ys.push_back(&n); });
+                  if (xs.size() != ys.size())
+                     break;
+                  std::size_t i = 0;
+                  while (i < xs.size() and hash(*xs[i]) == hash(*ys[i]))
+                     ++i;
+                  if (i == xs.size())
+                     break;
+                  x = xs[i];
+                  y = ys[i];
+               }
+               if (x->category > expr_cat and y->category > expr_cat)
+                  last = { x, y };
+               return last;
+            }
+
+            // The declarations of one name in a pair of scopes, by
+            // position, and the partner in B of each declaration of A.
+            struct Group {
+               std::vector<int> before;
+               std::vector<int> after;
+            };
+
+            // Pair the declarations of a group that are still unpaired
+            // and have the same key, each with the first such one of
+            // the other scope.
+            template<class F>
+            void pair_by(const Group& g, const Sequence<Decl>& a,
+                         const Sequence<Decl>& b, std::vector<int>& partner,
+                         std::vector<bool>& matched, F key)
+            {
+               std::unordered_map<Hash, std::vector<int>> candidates;
+               for (auto j = g.after.rbegin(); j != g.after.rend(); ++j)
+                  if (not matched[*j])
+                     candidates[key(b[*j])].push_back(*j);
+               for (int i : g.before) {
+                  if (partner[i] >= 0)
+                     continue;
+                  auto p = candidates.find(key(a[i]));
+                  if (p == candidates.end() or p->second.empty())
+                     continue;
+                  partner[i] = p->second.back();
+                  matched[partner[i]] = true;
+                  p->second.pop_back();
+               }
+            }
+
+            // Declarations of the same name are paired first when they
+            // are identical, then when they have the same type, and
+            // what remains in order of position, so that reordering or
+            // adding overloads does not change the pairing of others.
+            void scope(const std::string& prefix,
+                       const Sequence<Decl>& a, const Sequence<Decl>& b)
+            {
+               std::unordered_map<std::string, Group> names;
+               std::vector<std::string> before;
+               std::vector<std::string> after;
+               before.reserve(a.size());
+               after.reserve(b.size());
+               for (int i = 0; i < a.size(); ++i) {
+                  before.push_back(text(a[i]));
+                  names[before.back()].before.push_back(i);
+               }
+               for (int i = 0; i < b.size(); ++i) {
+                  after.push_back(text(b[i]));
+                  names[after.back()].after.push_back(i);
+               }
+
+               std::vector<int> partner(a.size(), -1);
+               std::vector<bool> matched(b.size());
+               for (auto& x : names) {
+                  const Group& g = x.second;
+                  if (g.before.size() > 1 or g.after.size() > 1) {
+                     pair_by(g, a, b, partner, matched,
+                             [this](const ipr::Decl& d) { return hash(d); });
+                     pair_by(g, a, b, partner, matched,
+                             [this](const ipr::Decl& d) {
+                                return hash(d.type());
+                             });
+                  }
+                  std::size_t j = 0;
+                  for (int i : g.before) {
+                     if (partner[i] >= 0)
+                        continue;
+                     while (j < g.after.size() and matched[g.after[j]])
+                        ++j;
+                     if (j == g.after.size())
+                        break;
+                     partner[i] = g.after[j];
+                     matched[g.after[j]] = true;
+                  }
+               }
+
+               for (int i = 0; i < a.size(); ++i)
+                  if (partner[i] < 0)
+                     entry(Change::Removed, prefix + before[i], &a[i],
+                           nullptr, nullptr, nullptr);
+                  else
+                     decl(prefix + before[i], a[i], b[partner[i]]);
+
+               for (int i = 0; i < b.size(); ++i)
+                  if (not matched[i])
+                     entry(Change::Added, prefix + after[i], nullptr, &b[i],
+                           nullptr, nullptr);
+            }
+
+            void decl(const std::string& name,
+                      const ipr::Decl& a, const ipr::Decl& b)
+            {
+               ++report.compared;
+               if (hash(a) == hash(b)) {
+                  ++report.identical;
+                  return;
+               }
+
+               const ipr::Udt* x = defined_udt(a);
+               const ipr::Udt* y = defined_udt(b);
+               if (x != nullptr and y != nullptr
+                   and x->category == y->category
+                   and a.specifiers() == b.specifiers()
+                   and hash(a.type()) == hash(b.type())) {
+                  udt(name, a, b, *x, *y);
+                  return;
+               }
+
+               Optional<Expr> u = a.initializer();
+               Optional<Expr> v = b.initializer();
+               if (a.category == b.category and bool(u) != bool(v)
+                   and hash(a.type()) == hash(b.type()))
+                  entry(Change::Changed, name, &a, &b,
+                        u ? &u.get() : nullptr, v ? &v.get() : nullptr);
+               else {
+                  auto diff = difference(a, b);
+                  entry(Change::Changed, name, &a, &b, diff.first, diff.second);
+               }
+            }
+
+            void udt(const std::string& name,
+                     const ipr::Decl& a, const ipr::Decl& b,
+                     const ipr::Udt& x, const ipr::Udt& y)
+            {
+               if (x.category == class_cat) {
+                  auto& u = static_cast<const ipr::Class&>(x).bases();
+                  auto& v = static_cast<const ipr::Class&>(y).bases();
+                  if (u.size() != v.size())
+                     entry(Change::Changed, name, &a, &b, &a, &b);
+                  else
+                     for (int i = 0; i < u.size(); ++i)
+                        if (hash(u[i]) != hash(v[i])) {
+                           auto diff = difference(u[i], v[i]);
+                           entry(Change::Changed, name, &a, &b,
+                                 diff.first, diff.second);
+                           break;
+                        }
+               }
+               scope(name + "::", x.scope().members(), y.scope().members());
+            }
+         };
+
+         void
+         print(Printer& pp, std::ostream& os, const ipr::Node* n)
+         {
+            if (n == nullptr)
+               os << "<none>";
+            else if (is_decl(n->category))
+               pp << xpr_decl(static_cast<const Expr&>(*n));
+            else if (n->category > stmt_cat)
+               pp << xpr_stmt(static_cast<const Expr&>(*n), false);
+            else if (n->category > type_cat and n->category < name_cat)
+               pp << xpr_type(static_cast<const Type&>(*n));
+            else if (n->category > expr_cat)
+               pp << xpr_expr(static_cast<const Expr&>(*n));
+            else
+               os << "<node " << n->node_id << '>';
+         }
+      }
+
+      Report
+      compare(const ipr::Translation_unit& a, const ipr::Translation_unit& b)
+      {
+         Comparer cmp;
+         cmp.scope("", a.global_namespace().members(),
+                   b.global_namespace().members());
+         return std::move(cmp.report);
+      }
+
+      std::ostream&
+      operator<<(std::ostream& os, const Report& r)
+      {
+         Printer pp { os };
+         for (auto& e : r.entries) {
+            switch (e.kind) {
+            case Change::Added:
+               os << "+ " << e.name;
+               break;
+
+            case Change::Removed:
+               os << "- " << e.name;
+               break;
+
+            case Change::Changed:
+               os << "~ " << e.name << ": ";
+               print(pp, os, e.old_node);
+               os << " ==> ";
+               print(pp, os, e.new_node);
+               break;
+            }
+            os << '\n';
+         }
+         return os;
+      }
+   }
+}
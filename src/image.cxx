@@ -0,0 +1,2105 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/image>
+#include <ipr/diff>
+#include <ipr/traversal>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#  define IPR_IMAGE_MMAP 1
+#endif
+
+namespace ipr {
+   namespace image {
+      const char magic[8] = { 'I', 'P', 'R', 'I', 'M', 'A', 'G', 'E' };
+
+      namespace {
+         using Word = Image::Word;
+         using Operands = std::vector<Word>;
+
+         [[noreturn]] void
+         corrupted()
+         {
+            throw std::domain_error("ipr::image: corrupted image");
+         }
+
+         [[noreturn]] void
+         unsupported(const ipr::Node& n)
+         {
+            throw std::domain_error
+               ("ipr::image: unsupported node of category "
+                + std::to_string(n.category));
+         }
+
+         inline bool
+         is_stmt(int c)
+         {
+            return c > stmt_cat and c <= using_directive and c != decl_cat;
+         }
+
+         // The builtin types of a Lexicon, in image order.
+         using Builtin = const ipr::Type& (ipr::Lexicon::*)() const;
+         const Builtin builtins[] = {
+            &ipr::Lexicon::void_type,
+            &ipr::Lexicon::bool_type,
+            &ipr::Lexicon::char_type,
+            &ipr::Lexicon::schar_type,
+            &ipr::Lexicon::uchar_type,
+            &ipr::Lexicon::wchar_t_type,
+            &ipr::Lexicon::short_type,
+            &ipr::Lexicon::ushort_type,
+            &ipr::Lexicon::int_type,
+            &ipr::Lexicon::uint_type,
+            &ipr::Lexicon::long_type,
+            &ipr::Lexicon::ulong_type,
+            &ipr::Lexicon::long_long_type,
+            &ipr::Lexicon::ulong_long_type,
+            &ipr::Lexicon::float_type,
+            &ipr::Lexicon::double_type,
+            &ipr::Lexicon::long_double_type,
+            &ipr::Lexicon::ellipsis_type,
+            &ipr::Lexicon::typename_type,
+            &ipr::Lexicon::class_type,
+            &ipr::Lexicon::union_type,
+            &ipr::Lexicon::enum_type,
+            &ipr::Lexicon::namespace_type
+         };
+         constexpr int builtin_count = sizeof builtins / sizeof builtins[0];
+
+         // Implementation classes are reached from the interface
+         // by the category code of a node.
+         template<class T>
+         inline const T&
+         rep(const ipr::Node& n)
+         {
+            return static_cast<const T&>(n);
+         }
+
+         template<class T>
+         inline T&
+         rep(const ipr::Node* n)
+         {
+            return const_cast<T&>(static_cast<const T&>(*n));
+         }
+
+         // A constraint that refers back to the expression itself is
+         // recomputed on restore.
+         inline bool
+         self_typed(const ipr::Node& x, const ipr::Type* t)
+         {
+            return t != nullptr and t->category == decltype_cat
+               and &rep<ipr::Decltype>(*t).expr() == &x;
+         }
+
+         // -- Writer --
+         // Linearize the nodes reachable from the global scope of
+         // a translation unit.  Declarations are written in scope
+         // order, bodies of user-defined types in breadth-first order.
+         struct Writer {
+            Writer(const ipr::Lexicon&, const ipr::Translation_unit&);
+            void write(std::ostream&) const;
+
+         private:
+            Node_map<Word> index { none };
+            std::unordered_map<int, Word> strings;
+            std::unordered_multimap<const ipr::Node*, Word> waiting;
+            std::deque<std::pair<Word, const ipr::Node*>> bodies;
+            std::vector<Word> string_ends;
+            std::string chars;
+            std::vector<Word> offsets;
+            std::vector<Word> words;
+            std::vector<Word> links;
+            std::vector<std::pair<Word, Word>> owned;
+
+            Word string(const ipr::String&);
+            Word node(const ipr::Node&);
+            Word optional(const ipr::Node* n) { return n ? node(*n) : none; }
+            Word region(const ipr::Region&);
+            Word lexical(const ipr::Region* r) { return r ? region(*r) : none; }
+            Word define(const ipr::Node&, Word, const Operands&);
+            void record(Word, const Operands&);
+            void refer(Word, const ipr::Node*);
+            Word encode(const ipr::Node&, Operands&, const ipr::Node*&);
+            void complete(const ipr::Node&, Word);
+            void body(Word, const ipr::Node&);
+            void scope(Word, const ipr::Scope&);
+            Word decl(Word, const ipr::Decl&);
+            void stmt(Word, const ipr::Stmt&);
+            void init(Word w, const ipr::Node* n)
+            {
+               if (n != nullptr) {
+                  const Word x = node(*n);
+                  record(init_tag, { w, x });
+                  link(w, init_link) = x;
+               }
+            }
+
+            Word& link(Word w, Link l) { return links[w * link_count + l]; }
+
+            // Record W as a member of its owner.
+            Word member(Word owner, Word w)
+            {
+               owned.emplace_back(owner, w);
+               return w;
+            }
+
+            template<class T>
+            Word classic(const T& x, Operands& ops, const ipr::Node*& ref)
+            {
+               ref = x.op_impl;
+               ops.push_back(x.op_impl != nullptr);
+               return x.category;
+            }
+
+            template<class T>
+            Word unary(const ipr::Node& n, Operands& ops,
+                       const ipr::Node*& ref)
+            {
+               auto& x = rep<T>(n);
+               ops = { node(x.rep), optional(x.constraint) };
+               return classic(x, ops, ref);
+            }
+
+            template<class T>
+            Word binary(const ipr::Node& n, Operands& ops,
+                        const ipr::Node*& ref)
+            {
+               auto& x = rep<T>(n);
+               ops = { node(x.rep.first), node(x.rep.second),
+                       optional(x.constraint) };
+               return classic(x, ops, ref);
+            }
+
+            template<class T>
+            Word conversion(const ipr::Node& n, Operands& ops,
+                            const ipr::Node*& ref)
+            {
+               auto& x = rep<T>(n);
+               ops = { node(x.rep.first), node(x.rep.second) };
+               return classic(x, ops, ref);
+            }
+         };
+
+         Writer::Writer(const ipr::Lexicon& lexicon,
+                        const ipr::Translation_unit& unit)
+         {
+            for (int i = 0; i < builtin_count; ++i) {
+               const ipr::Type& t = (lexicon.*builtins[i])();
+               define(t, builtin_tag, { Word(i) });
+            }
+            const ipr::Node& global = unit.global_namespace();
+            bodies.emplace_back(define(global, global_tag, { }), &global);
+            while (not bodies.empty()) {
+               auto b = bodies.front();
+               bodies.pop_front();
+               body(b.first, *b.second);
+            }
+            if (not waiting.empty())
+               throw std::domain_error
+                  ("ipr::image: reference to a declaration not in scope");
+         }
+
+         Word
+         Writer::string(const ipr::String& s)
+         {
+            auto p = strings.emplace(s.node_id, Word(string_ends.size()));
+            if (p.second) {
+               chars.append(s.begin(), s.end());
+               string_ends.push_back(chars.size());
+            }
+            return p.first->second;
+         }
+
+         void
+         Writer::record(Word tag, const Operands& ops)
+         {
+            words.push_back(tag);
+            words.push_back(ops.size());
+            words.insert(words.end(), ops.begin(), ops.end());
+         }
+
+         Word
+         Writer::define(const ipr::Node& n, Word tag, const Operands& ops)
+         {
+            const Word w = offsets.size();
+            offsets.push_back(words.size());
+            links.resize(links.size() + link_count, none);
+            record(tag, ops);
+            index[n] = w;
+            if (not waiting.empty()) {
+               auto range = waiting.equal_range(&n);
+               for (auto p = range.first; p != range.second; ++p) {
+                  record(fixup_tag, { p->second, w });
+                  link(p->second, ref_link) = w;
+               }
+               waiting.erase(range.first, range.second);
+            }
+            return w;
+         }
+
+         void
+         Writer::refer(Word w, const ipr::Node* target)
+         {
+            if (target == nullptr)
+               return;
+            const Word x = index(*target);
+            if (x != none) {
+               record(fixup_tag, { w, x });
+               link(w, ref_link) = x;
+            }
+            else
+               waiting.emplace(target, w);
+         }
+
+         Word
+         Writer::node(const ipr::Node& n)
+         {
+            const Word x = index(n);
+            if (x != none)
+               return x;
+            // Declarations are only defined by the walk of their scopes.
+            if (is_decl(n.category))
+               throw std::domain_error
+                  ("ipr::image: reference to a declaration not in scope");
+
+            Operands ops;
+            const ipr::Node* ref = nullptr;
+            const Word tag = encode(n, ops, ref);
+            const Word w = define(n, tag, ops);
+            refer(w, ref);
+            complete(n, w);
+            if (is_stmt(n.category))
+               stmt(w, rep<ipr::Stmt>(n));
+            return w;
+         }
+
+         // Return the node index of the owner of a region.
+         Word
+         Writer::region(const ipr::Region& r)
+         {
+            const ipr::Node& owner = r.owner();
+            const ipr::Region* main = nullptr;
+            switch (owner.category) {
+            case class_cat: case union_cat: case namespace_cat: case enum_cat:
+               main = &rep<ipr::Udt>(owner).region();
+               break;
+            case mapping_cat:
+               main = &rep<impl::Mapping>(owner).parameters;
+               break;
+            case block_cat:
+               main = &rep<impl::Block>(owner).region;
+               break;
+            default:
+               break;
+            }
+            if (main != &r)
+               unsupported(r);
+            return node(owner);
+         }
+
+         Word
+         Writer::encode(const ipr::Node& n, Operands& ops,
+                        const ipr::Node*& ref)
+         {
+            switch (n.category) {
+            case linkage_cat:
+               ops = { string(rep<ipr::Linkage>(n).language()) };
+               break;
+
+            case identifier_cat:
+               ops = { string(rep<ipr::Identifier>(n).string()) };
+               break;
+            case operator_cat:
+               ops = { string(rep<ipr::Operator>(n).opname()) };
+               break;
+            case conversion_cat:
+               ops = { node(rep<ipr::Conversion>(n).target()) };
+               break;
+            case ctor_name_cat:
+               ops = { node(rep<ipr::Ctor_name>(n).object_type()) };
+               break;
+            case dtor_name_cat:
+               ops = { node(rep<ipr::Dtor_name>(n).object_type()) };
+               break;
+            case type_id_cat:
+               ops = { node(rep<ipr::Type_id>(n).type_expr()) };
+               break;
+            case scope_ref_cat: {
+               auto& x = rep<impl::Scope_ref>(n);
+               ops = { node(x.rep.first), node(x.rep.second),
+                       self_typed(x, x.constraint)
+                       ? none : optional(x.constraint) };
+               break;
+            }
+            case template_id_cat: {
+               auto& x = rep<impl::Template_id>(n);
+               ops = { node(x.rep.first), node(x.rep.second),
+                       self_typed(x, x.constraint)
+                       ? none : optional(x.constraint) };
+               break;
+            }
+
+            case array_cat: {
+               auto& x = rep<ipr::Array>(n);
+               ops = { node(x.element_type()), node(x.bound()) };
+               break;
+            }
+            case as_type_cat: {
+               auto& x = rep<ipr::As_type>(n);
+               ops = { node(x.expr()), node(x.lang_linkage()) };
+               break;
+            }
+            case decltype_cat:
+               ops = { node(rep<ipr::Decltype>(n).expr()) };
+               break;
+            case function_cat: {
+               auto& x = rep<ipr::Function>(n);
+               ops = { node(x.source()), node(x.target()),
+                       node(x.throws()), node(x.lang_linkage()) };
+               break;
+            }
+            case pointer_cat:
+               ops = { node(rep<ipr::Pointer>(n).points_to()) };
+               break;
+            case reference_cat:
+               ops = { node(rep<ipr::Reference>(n).refers_to()) };
+               break;
+            case rvalue_reference_cat:
+               ops = { node(rep<ipr::Rvalue_reference>(n).refers_to()) };
+               break;
+            case ptr_to_member_cat: {
+               auto& x = rep<ipr::Ptr_to_member>(n);
+               ops = { node(x.containing_type()), node(x.member_type()) };
+               break;
+            }
+            case qualified_cat: {
+               auto& x = rep<ipr::Qualified>(n);
+               ops = { Word(x.qualifiers()), node(x.main_variant()) };
+               break;
+            }
+            case product_cat:
+               for (auto& t : rep<ipr::Product>(n).elements())
+                  ops.push_back(node(t));
+               break;
+            case sum_cat:
+               for (auto& t : rep<ipr::Sum>(n).elements())
+                  ops.push_back(node(t));
+               break;
+            case template_cat: {
+               auto& x = rep<ipr::Template>(n);
+               ops = { node(x.source()), node(x.target()) };
+               break;
+            }
+            case auto_cat:
+               break;
+
+            case class_cat: {
+               auto& x = rep<impl::Class>(n);
+               ops = { region(x.body.enclosing()), optional(x.id),
+                       node(x.type()) };
+               break;
+            }
+            case union_cat: {
+               auto& x = rep<impl::Union>(n);
+               ops = { region(x.body.enclosing()), optional(x.id),
+                       node(x.type()) };
+               break;
+            }
+            case namespace_cat: {
+               auto& x = rep<impl::Namespace>(n);
+               ops = { region(x.body.enclosing()), optional(x.id),
+                       node(x.type()) };
+               break;
+            }
+            case enum_cat: {
+               auto& x = rep<impl::Enum>(n);
+               ops = { region(x.body.enclosing()), optional(x.id),
+                       node(x.type()), Word(x.kind()) };
+               break;
+            }
+
+            case phantom_cat:
+               ops = { optional(rep<impl::Phantom>(n).constraint) };
+               break;
+            case literal_cat: {
+               auto& x = rep<impl::Literal>(n);
+               ops = { node(x.rep.first), string(x.rep.second) };
+               break;
+            }
+            case expr_list_cat:
+               for (auto& e : rep<ipr::Expr_list>(n).elements())
+                  ops.push_back(node(e));
+               break;
+            case id_expr_cat: {
+               auto& x = rep<impl::Id_expr>(n);
+               ops = { node(x.rep), optional(x.constraint) };
+               ref = x.decl;
+               break;
+            }
+            case sizeof_cat: {
+               auto& x = rep<impl::Sizeof>(n);
+               ops = { node(x.rep), optional(x.constraint) };
+               break;
+            }
+            case typeid_cat: {
+               auto& x = rep<impl::Typeid>(n);
+               ops = { node(x.rep), optional(x.constraint) };
+               break;
+            }
+            case member_init_cat: {
+               auto& x = rep<impl::Member_init>(n);
+               ops = { node(x.rep.first), node(x.rep.second),
+                       optional(x.constraint) };
+               break;
+            }
+            case paren_expr_cat: {
+               auto& x = rep<impl::Paren_expr>(n);
+               ops = { node(x.rep) };
+               return classic(x, ops, ref);
+            }
+            case conditional_cat: {
+               auto& x = rep<impl::Conditional>(n);
+               ops = { node(x.rep.first), node(x.rep.second),
+                       node(x.rep.third), optional(x.constraint) };
+               return classic(x, ops, ref);
+            }
+            case new_cat: {
+               auto& x = rep<impl::New>(n);
+               ops = { optional(x.where), node(x.what), optional(x.args),
+                       optional(x.constraint) };
+               return classic(x, ops, ref);
+            }
+            case mapping_cat: {
+               auto& x = rep<impl::Mapping>(n);
+               ops = { region(x.parameters.enclosing()),
+                       Word(x.nesting_level),
+                       node(*x.parameters.scope.decls.constraint),
+                       optional(x.constraint), optional(x.value_type) };
+               break;
+            }
+
+            case address_cat: return unary<impl::Address>(n, ops, ref);
+            case array_delete_cat:
+               return unary<impl::Array_delete>(n, ops, ref);
+            case complement_cat: return unary<impl::Complement>(n, ops, ref);
+            case delete_cat: return unary<impl::Delete>(n, ops, ref);
+            case deref_cat: return unary<impl::Deref>(n, ops, ref);
+            case initializer_list_cat:
+               return unary<impl::Initializer_list>(n, ops, ref);
+            case not_cat: return unary<impl::Not>(n, ops, ref);
+            case post_decrement_cat:
+               return unary<impl::Post_decrement>(n, ops, ref);
+            case post_increment_cat:
+               return unary<impl::Post_increment>(n, ops, ref);
+            case pre_decrement_cat:
+               return unary<impl::Pre_decrement>(n, ops, ref);
+            case pre_increment_cat:
+               return unary<impl::Pre_increment>(n, ops, ref);
+            case throw_cat: return unary<impl::Throw>(n, ops, ref);
+            case unary_minus_cat: return unary<impl::Unary_minus>(n, ops, ref);
+            case unary_plus_cat: return unary<impl::Unary_plus>(n, ops, ref);
+            case expansion_cat: return unary<impl::Expansion>(n, ops, ref);
+
+            case plus_cat: return binary<impl::Plus>(n, ops, ref);
+            case plus_assign_cat: return binary<impl::Plus_assign>(n, ops, ref);
+            case and_cat: return binary<impl::And>(n, ops, ref);
+            case array_ref_cat: return binary<impl::Array_ref>(n, ops, ref);
+            case arrow_cat: return binary<impl::Arrow>(n, ops, ref);
+            case arrow_star_cat: return binary<impl::Arrow_star>(n, ops, ref);
+            case assign_cat: return binary<impl::Assign>(n, ops, ref);
+            case bitand_cat: return binary<impl::Bitand>(n, ops, ref);
+            case bitand_assign_cat:
+               return binary<impl::Bitand_assign>(n, ops, ref);
+            case bitor_cat: return binary<impl::Bitor>(n, ops, ref);
+            case bitor_assign_cat:
+               return binary<impl::Bitor_assign>(n, ops, ref);
+            case bitxor_cat: return binary<impl::Bitxor>(n, ops, ref);
+            case bitxor_assign_cat:
+               return binary<impl::Bitxor_assign>(n, ops, ref);
+            case call_cat: return binary<impl::Call>(n, ops, ref);
+            case comma_cat: return binary<impl::Comma>(n, ops, ref);
+            case div_cat: return binary<impl::Div>(n, ops, ref);
+            case div_assign_cat: return binary<impl::Div_assign>(n, ops, ref);
+            case dot_cat: return binary<impl::Dot>(n, ops, ref);
+            case dot_star_cat: return binary<impl::Dot_star>(n, ops, ref);
+            case equal_cat: return binary<impl::Equal>(n, ops, ref);
+            case greater_cat: return binary<impl::Greater>(n, ops, ref);
+            case greater_equal_cat:
+               return binary<impl::Greater_equal>(n, ops, ref);
+            case less_cat: return binary<impl::Less>(n, ops, ref);
+            case less_equal_cat: return binary<impl::Less_equal>(n, ops, ref);
+            case lshift_cat: return binary<impl::Lshift>(n, ops, ref);
+            case lshift_assign_cat:
+               return binary<impl::Lshift_assign>(n, ops, ref);
+            case modulo_cat: return binary<impl::Modulo>(n, ops, ref);
+            case modulo_assign_cat:
+               return binary<impl::Modulo_assign>(n, ops, ref);
+            case mul_cat: return binary<impl::Mul>(n, ops, ref);
+            case mul_assign_cat: return binary<impl::Mul_assign>(n, ops, ref);
+            case not_equal_cat: return binary<impl::Not_equal>(n, ops, ref);
+            case or_cat: return binary<impl::Or>(n, ops, ref);
+            case rshift_cat: return binary<impl::Rshift>(n, ops, ref);
+            case rshift_assign_cat:
+               return binary<impl::Rshift_assign>(n, ops, ref);
+            case minus_cat: return binary<impl::Minus>(n, ops, ref);
+            case minus_assign_cat:
+               return binary<impl::Minus_assign>(n, ops, ref);
+
+            case cast_cat: return conversion<impl::Cast>(n, ops, ref);
+            case const_cast_cat:
+               return conversion<impl::Const_cast>(n, ops, ref);
+            case datum_cat: return conversion<impl::Datum>(n, ops, ref);
+            case dynamic_cast_cat:
+               return conversion<impl::Dynamic_cast>(n, ops, ref);
+            case reinterpret_cast_cat:
+               return conversion<impl::Reinterpret_cast>(n, ops, ref);
+            case static_cast_cat:
+               return conversion<impl::Static_cast>(n, ops, ref);
+
+            case block_cat: {
+               auto& x = rep<impl::Block>(n);
+               if (x.region.parent == nullptr)
+                  unsupported(n);
+               ops = { region(*x.region.parent),
+                       node(x.region.scope.type().type()) };
+               break;
+            }
+            case break_cat:
+               ref = rep<impl::Break>(n).stmt;
+               break;
+            case continue_cat:
+               ref = rep<impl::Continue>(n).stmt;
+               break;
+            case ctor_body_cat: {
+               auto& x = rep<impl::Ctor_body>(n);
+               ops = { node(x.rep.first), node(x.rep.second),
+                       optional(x.constraint) };
+               break;
+            }
+            case do_cat: {
+               auto& x = rep<impl::Do>(n);
+               ops = { node(x.rep.first), node(x.rep.second) };
+               break;
+            }
+            case expr_stmt_cat:
+               // An empty statement has no operand of its own.
+               if (util::view<ipr::Empty_stmt>(n) == nullptr)
+                  ops = { node(rep<impl::Expr_stmt>(n).rep) };
+               break;
+            case for_cat: {
+               auto& x = rep<impl::For>(n);
+               ops = { optional(x.init), optional(x.cond), optional(x.inc),
+                       optional(x.stmt), optional(x.constraint) };
+               break;
+            }
+            case for_in_cat: {
+               auto& x = rep<impl::For_in>(n);
+               ops = { optional(x.seq), optional(x.stmt),
+                       optional(x.constraint) };
+               ref = x.var;
+               break;
+            }
+            case goto_cat:
+               ops = { node(rep<impl::Goto>(n).rep) };
+               break;
+            case return_cat:
+               ops = { node(rep<impl::Return>(n).rep) };
+               break;
+            case handler_cat: {
+               auto& x = rep<impl::Handler>(n);
+               const Word block = node(x.rep.second);
+               ops = { node(x.rep.first), block };
+               break;
+            }
+            case if_then_cat: {
+               auto& x = rep<impl::If_then>(n);
+               ops = { node(x.rep.first), node(x.rep.second) };
+               break;
+            }
+            case if_then_else_cat: {
+               auto& x = rep<impl::If_then_else>(n);
+               ops = { node(x.rep.first), node(x.rep.second),
+                       node(x.rep.third), optional(x.constraint) };
+               break;
+            }
+            case labeled_stmt_cat: {
+               auto& x = rep<impl::Labeled_stmt>(n);
+               ops = { node(x.rep.first), node(x.rep.second) };
+               break;
+            }
+            case switch_cat: {
+               auto& x = rep<impl::Switch>(n);
+               ops = { node(x.rep.first), node(x.rep.second) };
+               break;
+            }
+            case while_cat: {
+               auto& x = rep<impl::While>(n);
+               ops = { node(x.rep.first), node(x.rep.second) };
+               break;
+            }
+
+            default:
+               unsupported(n);
+            }
+            return n.category;
+         }
+
+         // Emit what must follow the definition of a node.
+         void
+         Writer::complete(const ipr::Node& n, Word w)
+         {
+            switch (n.category) {
+            case class_cat: case union_cat: case namespace_cat: case enum_cat:
+               bodies.emplace_back(w, &n);
+               break;
+
+            case mapping_cat: {
+               auto& x = rep<impl::Mapping>(n);
+               for (int i = 0; i < x.parameters.size(); ++i) {
+                  auto& p = x.parameters.scope.decls.seq.get(i);
+                  const Word name = node(p.name());
+                  const Word type = node(p.type());
+                  const Word param = member(w, define(p, parameter_cat,
+                                                      { w, name, type }));
+                  stmt(param, p);
+                  init(param, p.init);
+               }
+               init(w, x.body);
+               break;
+            }
+
+            case block_cat: {
+               auto& x = rep<impl::Block>(n);
+               scope(w, x.region.scope);
+               Operands ops = { w, Word(x.stmt_seq.size()) };
+               for (auto& s : x.stmt_seq)
+                  ops.push_back(node(s));
+               ops.push_back(x.handler_seq.size());
+               for (auto& h : x.handler_seq)
+                  ops.push_back(node(h));
+               link(w, body_link) = words.size();
+               record(body_tag, ops);
+               break;
+            }
+
+            default:
+               break;
+            }
+         }
+
+         // Emit the members of a user-defined type.
+         void
+         Writer::body(Word w, const ipr::Node& n)
+         {
+            switch (n.category) {
+            case class_cat:
+               for (auto& b : rep<impl::Class>(n).bases()) {
+                  auto& x = rep<impl::Base_type>(b);
+                  const Word type = node(x.type());
+                  const Word base = member(w, define(x, base_type_cat,
+                                                     { w, type, Word(x.spec) }));
+                  stmt(base, x);
+               }
+               scope(w, rep<impl::Class>(n).body.scope);
+               break;
+
+            case enum_cat:
+               for (auto& e : rep<impl::Enum>(n).members()) {
+                  auto& x = rep<impl::Enumerator>(e);
+                  const Word name = node(x.name());
+                  const Word m = member(w, define(x, enumerator_cat,
+                                                 { w, name }));
+                  stmt(m, x);
+                  init(m, x.init);
+               }
+               break;
+
+            default:
+               scope(w, rep<ipr::Udt>(n).scope());
+               break;
+            }
+         }
+
+         void
+         Writer::scope(Word home, const ipr::Scope& s)
+         {
+            for (int i = 0, n = s.size(); i < n; ++i)
+               member(home, decl(home, s[i]));
+         }
+
+         Word
+         Writer::decl(Word home, const ipr::Decl& d)
+         {
+            if (d.substitutions().size() != 0)
+               unsupported(d);
+            const Word name = node(d.name());
+            const Word spec = Word(d.specifiers());
+            Word w;
+            switch (d.category) {
+            case alias_cat: {
+               auto& x = rep<impl::Alias>(d);
+               const Word aliasee = node(*x.aliasee);
+               w = define(d, alias_cat,
+                          { home, name, aliasee, spec, lexical(x.lexreg) });
+               break;
+            }
+            case var_cat: {
+               auto& x = rep<impl::Var>(d);
+               const Word type = node(x.type());
+               w = define(d, var_cat,
+                          { home, name, type, spec, lexical(x.lexreg) });
+               stmt(w, d);
+               init(w, x.init);
+               return w;
+            }
+            case field_cat: {
+               auto& x = rep<impl::Field>(d);
+               const Word type = node(x.type());
+               w = define(d, field_cat, { home, name, type, spec, none });
+               stmt(w, d);
+               init(w, x.init);
+               return w;
+            }
+            case bitfield_cat: {
+               auto& x = rep<impl::Bitfield>(d);
+               const Word type = node(x.type());
+               const Word length = optional(x.length);
+               w = define(d, bitfield_cat,
+                          { home, name, type, spec, none, length });
+               stmt(w, d);
+               init(w, x.init);
+               return w;
+            }
+            case typedecl_cat: {
+               auto& x = rep<impl::Typedecl>(d);
+               const Word type = node(x.type());
+               w = define(d, typedecl_cat,
+                          { home, name, type, spec, lexical(x.lexreg) });
+               stmt(w, d);
+               init(w, x.init);
+               return w;
+            }
+            case fundecl_cat: {
+               auto& x = rep<impl::Fundecl>(d);
+               const Word type = node(x.type());
+               w = define(d, fundecl_cat,
+                          { home, name, type, spec, lexical(x.lexreg) });
+               stmt(w, d);
+               init(w, x.init);
+               return w;
+            }
+            case named_map_cat: {
+               auto& x = rep<impl::Named_map>(d);
+               const Word type = node(x.type());
+               const Word primary = x.decl_data.master_data->primary != nullptr;
+               w = define(d, named_map_cat, { home, name, type, spec,
+                                               lexical(x.lexreg), primary });
+               stmt(w, d);
+               init(w, x.init);
+               return w;
+            }
+            default:
+               unsupported(d);
+            }
+            stmt(w, d);
+            return w;
+         }
+
+         // Emit the location of a statement, when known.
+         void
+         Writer::stmt(Word w, const ipr::Stmt& s)
+         {
+            if (s.annotation().size() != 0 or s.attributes().size() != 0)
+               unsupported(s);
+            const ipr::Source_location& src = s.source_location();
+            const ipr::Unit_location& unit = s.unit_location();
+            const Operands locus = {
+               w, Word(src.line), Word(src.column), Word(src.file),
+               Word(unit.line), Word(unit.column), Word(unit.unit)
+            };
+            for (std::size_t i = 1; i < locus.size(); ++i)
+               if (locus[i] != 0) {
+                  link(w, locus_link) = words.size();
+                  record(locus_tag, locus);
+                  break;
+               }
+         }
+
+         void
+         Writer::write(std::ostream& os) const
+         {
+            Header header = { };
+            std::memcpy(header.magic, magic, sizeof magic);
+            header.version = version;
+            header.byte_order = byte_order;
+            header.string_count = string_ends.size();
+            header.string_bytes = chars.size();
+            header.node_count = offsets.size();
+            header.word_count = words.size();
+            header.member_count = owned.size();
+
+            // Members, grouped by owner in order of definition.
+            std::vector<Word> starts(offsets.size() + 1);
+            for (auto& m : owned)
+               ++starts[m.first + 1];
+            for (std::size_t i = 1; i < starts.size(); ++i)
+               starts[i] += starts[i - 1];
+            std::vector<Word> members(owned.size());
+            std::vector<Word> next(starts.begin(), starts.end() - 1);
+            for (auto& m : owned)
+               members[next[m.first]++] = m.second;
+
+            static const char padding[sizeof(Word)] = { };
+            os.write(reinterpret_cast<const char*>(&header), sizeof header);
+            os.write(reinterpret_cast<const char*>(string_ends.data()),
+                     string_ends.size() * sizeof(Word));
+            os.write(chars.data(), chars.size());
+            os.write(padding, -chars.size() % sizeof(Word));
+            os.write(reinterpret_cast<const char*>(offsets.data()),
+                     offsets.size() * sizeof(Word));
+            os.write(reinterpret_cast<const char*>(words.data()),
+                     words.size() * sizeof(Word));
+            os.write(reinterpret_cast<const char*>(links.data()),
+                     links.size() * sizeof(Word));
+            os.write(reinterpret_cast<const char*>(starts.data()),
+                     starts.size() * sizeof(Word));
+            os.write(reinterpret_cast<const char*>(members.data()),
+                     members.size() * sizeof(Word));
+            if (not os)
+               throw std::domain_error("ipr::image: write error");
+         }
+
+
+
+         // -- Reader --
+         // Replay the records of an image through the factories of
+         // a Lexicon, in a single forward pass.
+         // The state of a merge into a unit, across the images merged.
+         struct Merger {
+            diff::Hasher hash;          // of the definitions in the unit
+            Merge_report report;
+         };
+
+         struct Reader {
+            Reader(const Image&, impl::Lexicon&, impl::Translation_unit&,
+                   Merger* = nullptr);
+            int run();
+
+         private:
+            const Image& image;
+            impl::Lexicon& lexicon;
+            impl::Translation_unit& unit;
+            std::vector<const ipr::String*> strings;
+            std::vector<const ipr::Node*> nodes;
+            std::vector<impl::Stmt_common*> commons;
+            std::vector<const ipr::Type*> operand_types;
+            std::unordered_map<Word, const ipr::Decl**> impls;
+            impl::Stmt_common* common;
+            const Word* ops;
+            Word count;
+
+            // When merging: the image as a unit, to hash its
+            // definitions; the nodes that stand for earlier nodes of
+            // the unit, and among them the unified types, whose members
+            // are the earlier members.
+            Merger* merger;
+            std::unique_ptr<View> view;
+            diff::Hasher incoming;
+            std::vector<bool> kept;
+            std::vector<bool> sealed;
+            std::unordered_map<Word, const ipr::Node*> pending;
+            std::unordered_map<std::uint64_t, int> ordinals;
+            std::unordered_map<Word, const ipr::Decl*> conflicts;
+            const ipr::Decl* conflict;
+            int mark;           // node_id of the first node of this image
+
+            Word arg(Word i) const
+            {
+               if (i >= count)
+                  corrupted();
+               return ops[i];
+            }
+
+            const ipr::Node* at(Word w) const
+            {
+               if (w >= nodes.size())
+                  corrupted();
+               return nodes[w];
+            }
+
+            template<class T>
+            const T& get(Word i) const { return rep<T>(*at(arg(i))); }
+
+            template<class T>
+            const T* get_opt(Word i) const
+            {
+               const Word w = arg(i);
+               return w == none ? nullptr : &rep<T>(*at(w));
+            }
+
+            const ipr::Decl& decl(Word i) const
+            {
+               const ipr::Node* n = at(arg(i));
+               if (not is_decl(n->category))
+                  corrupted();
+               return rep<ipr::Decl>(*n);
+            }
+
+            const ipr::String& string(Word i) const
+            {
+               const Word w = arg(i);
+               if (w >= strings.size())
+                  corrupted();
+               return *strings[w];
+            }
+
+            bool is_kept(Word w) const { return w < kept.size() and kept[w]; }
+
+            const ipr::Region& region(Word);
+            const ipr::Node* decode(Word);
+            const ipr::Node* declaration(Word);
+            const ipr::Node* adopt(Word);
+            const ipr::Node* adopt(Word, const ipr::Udt&);
+            const ipr::Decl& member(Word, Word);
+            const ipr::Node* keep(Word, const ipr::Decl&);
+            const ipr::Node* unify(Word);
+            void initialize();
+            void fixup();
+            void body();
+            void locus();
+
+            static impl::Region& members(impl::Region& r) { return r; }
+
+            template<class T>
+            static impl::Region& members(impl::Udt<T>& t) { return t.body; }
+
+            // Apply F to the region or user-defined type with index W,
+            // so that members of a user-defined type get their membership.
+            template<class F>
+            decltype(auto) declare(Word w, F f)
+            {
+               const ipr::Node* n = at(w);
+               if (n == &unit.global_namespace())
+                  return f(*unit.global_region());
+               switch (n->category) {
+               case class_cat: return f(rep<impl::Class>(n));
+               case union_cat: return f(rep<impl::Union>(n));
+               case namespace_cat: return f(rep<impl::Namespace>(n));
+               case block_cat: return f(rep<impl::Block>(n).region);
+               default: corrupted();
+               }
+            }
+
+            void implementation(const ipr::Decl*& slot, Word i)
+            {
+               if (arg(i) != 0)
+                  impls.emplace(nodes.size(), &slot);
+            }
+
+            template<class F, class T, class A>
+            const ipr::Node* unary(T* (F::*make)(const A&))
+            {
+               T* x = (lexicon.*make)(get<A>(0));
+               x->constraint = get_opt<ipr::Type>(1);
+               implementation(x->op_impl, 2);
+               return x;
+            }
+
+            template<class F, class T, class A, class B>
+            const ipr::Node* binary(T* (F::*make)(const A&, const B&))
+            {
+               T* x = (lexicon.*make)(get<A>(0), get<B>(1));
+               x->constraint = get_opt<ipr::Type>(2);
+               implementation(x->op_impl, 3);
+               return x;
+            }
+
+            template<class F, class T, class A, class B>
+            const ipr::Node* conversion(T* (F::*make)(const A&, const B&))
+            {
+               T* x = (lexicon.*make)(get<A>(0), get<B>(1));
+               implementation(x->op_impl, 2);
+               return x;
+            }
+
+            template<class F, class T, class A, class B>
+            const ipr::Node* statement(T* (F::*make)(const A&, const B&))
+            {
+               T* x = (lexicon.*make)(get<A>(0), get<B>(1));
+               common = x;
+               return x;
+            }
+
+            template<class T>
+            const ipr::Node* udt(T* x)
+            {
+               if (arg(1) != none)
+                  x->id = &get<ipr::Name>(1);
+               x->constraint = &get<ipr::Type>(2);
+               return x;
+            }
+
+            // The operands, as types, in a buffer reused across nodes.
+            const std::vector<const ipr::Type*>& types()
+            {
+               operand_types.clear();
+               for (Word i = 0; i < count; ++i)
+                  operand_types.push_back(&get<ipr::Type>(i));
+               return operand_types;
+            }
+         };
+
+         Reader::Reader(const Image& i, impl::Lexicon& l,
+                        impl::Translation_unit& u, Merger* m)
+               : image(i), lexicon(l), unit(u),
+                 common(nullptr), ops(nullptr), count(0),
+                 merger(m), conflict(nullptr),
+                 mark(stats::all_nodes_count())
+         {
+            if (merger != nullptr) {
+               view.reset(new View(image));
+               kept.resize(image.node_count());
+               sealed.resize(image.node_count());
+            }
+            const int n = image.string_count();
+            strings.reserve(n);
+            for (int i = 0; i < n; ++i) {
+               const Image::Text s = image.string(i);
+               strings.push_back
+                  (&lexicon.get_string(std::string(s.first, s.second)));
+            }
+            nodes.reserve(image.node_count());
+            commons.reserve(image.node_count());
+         }
+
+         int
+         Reader::run()
+         {
+            for (const Word* p = image.begin(); p != image.end(); ) {
+               if (image.end() - p < 2 or Word(image.end() - p - 2) < p[1])
+                  corrupted();
+               const Word tag = p[0];
+               count = p[1];
+               ops = p + 2;
+               p = ops + count;
+               switch (tag) {
+               case init_tag: initialize(); break;
+               case fixup_tag: fixup(); break;
+               case body_tag: body(); break;
+               case locus_tag: locus(); break;
+               default:
+                  common = nullptr;
+                  const ipr::Node* n = merger ? adopt(tag) : nullptr;
+                  if (n == nullptr) {
+                     n = is_decl(tag) ? declaration(tag) : decode(tag);
+                     if (conflict != nullptr) {
+                        merger->report.conflicts.push_back
+                           ({ conflict, &rep<ipr::Decl>(*n) });
+                        conflict = nullptr;
+                     }
+                  }
+                  nodes.push_back(n);
+                  commons.push_back(common);
+                  break;
+               }
+            }
+            if (nodes.size() != Word(image.node_count()) or not impls.empty())
+               corrupted();
+            return nodes.size();
+         }
+
+         // The region owned by the node with index W.
+         const ipr::Region&
+         Reader::region(Word w)
+         {
+            const ipr::Node* n = at(w);
+            if (n == &unit.global_namespace())
+               return *unit.global_region();
+            switch (n->category) {
+            case class_cat: case union_cat: case namespace_cat: case enum_cat:
+               return rep<ipr::Udt>(*n).region();
+            case mapping_cat:
+               return rep<impl::Mapping>(n).parameters;
+            case block_cat:
+               return rep<impl::Block>(n).region;
+            default:
+               corrupted();
+            }
+         }
+
+         const ipr::Node*
+         Reader::declaration(Word tag)
+         {
+            switch (tag) {
+            case base_type_cat: {
+               const ipr::Node* n = at(arg(0));
+               if (n->category != class_cat)
+                  corrupted();
+               impl::Base_type* x =
+                  rep<impl::Class>(n).declare_base(get<ipr::Type>(1));
+               x->spec = ipr::DeclSpecifiers(arg(2));
+               common = x;
+               return x;
+            }
+            case enumerator_cat: {
+               const ipr::Node* n = at(arg(0));
+               if (n->category != enum_cat)
+                  corrupted();
+               impl::Enumerator* x =
+                  rep<impl::Enum>(n).add_member(get<ipr::Name>(1));
+               common = x;
+               return x;
+            }
+            case parameter_cat: {
+               const ipr::Node* n = at(arg(0));
+               if (n->category != mapping_cat)
+                  corrupted();
+               impl::Parameter* x = lexicon.make_parameter
+                  (get<ipr::Name>(1), get<ipr::Type>(2),
+                   rep<impl::Mapping>(n));
+               common = x;
+               return x;
+            }
+            default:
+               break;
+            }
+
+            const ipr::Name& name = get<ipr::Name>(1);
+            const ipr::DeclSpecifiers spec = ipr::DeclSpecifiers(arg(3));
+            const ipr::Region* lexreg =
+               arg(4) == none ? nullptr : &region(arg(4));
+            switch (tag) {
+            case alias_cat: {
+               impl::Region& home = declare(arg(0), [](auto& h)
+                                            -> impl::Region& {
+                     return members(h);
+                  });
+               impl::Alias* x = home.scope.make_alias(name, get<ipr::Expr>(2));
+               x->decl_data.spec = spec;
+               x->lexreg = lexreg;
+               common = x;
+               return x;
+            }
+            case var_cat: {
+               auto& type = get<ipr::Type>(2);
+               impl::Var* x = declare(arg(0), [&](auto& h) {
+                     return h.declare_var(name, type);
+                  });
+               x->decl_data.spec = spec;
+               x->lexreg = lexreg;
+               common = x;
+               return x;
+            }
+            case field_cat: {
+               auto& type = get<ipr::Type>(2);
+               impl::Field* x = declare(arg(0), [&](auto& h) {
+                     return h.declare_field(name, type);
+                  });
+               x->decl_data.spec = spec;
+               common = x;
+               return x;
+            }
+            case bitfield_cat: {
+               auto& type = get<ipr::Type>(2);
+               impl::Bitfield* x = declare(arg(0), [&](auto& h) {
+                     return h.declare_bitfield(name, type);
+                  });
+               x->decl_data.spec = spec;
+               x->length = get_opt<ipr::Expr>(5);
+               common = x;
+               return x;
+            }
+            case typedecl_cat: {
+               auto& type = get<ipr::Type>(2);
+               impl::Typedecl* x = declare(arg(0), [&](auto& h) {
+                     return h.declare_type(name, type);
+                  });
+               x->decl_data.spec = spec;
+               x->lexreg = lexreg;
+               common = x;
+               return x;
+            }
+            case fundecl_cat: {
+               auto& type = get<ipr::Function>(2);
+               impl::Fundecl* x = declare(arg(0), [&](auto& h) {
+                     return h.declare_fun(name, type);
+                  });
+               x->decl_data.spec = spec;
+               x->lexreg = lexreg;
+               common = x;
+               return x;
+            }
+            case named_map_cat: {
+               auto& type = get<ipr::Template>(2);
+               const bool primary = arg(5) != 0;
+               impl::Named_map* x = declare(arg(0), [&](auto& h) {
+                     return primary ? h.declare_primary_map(name, type)
+                        : h.declare_secondary_map(name, type);
+                  });
+               x->decl_data.spec = spec;
+               x->lexreg = lexreg;
+               common = x;
+               return x;
+            }
+            default:
+               corrupted();
+            }
+         }
+
+         const ipr::Node*
+         Reader::decode(Word tag)
+         {
+            using F = impl::expr_factory;
+            using S = impl::stmt_factory;
+            switch (tag) {
+            case builtin_tag:
+               if (arg(0) >= Word(builtin_count))
+                  corrupted();
+               return &(lexicon.*builtins[arg(0)])();
+            case global_tag:
+               return &unit.global_namespace();
+
+            case linkage_cat:
+               return &lexicon.get_linkage(string(0));
+
+            case identifier_cat:
+               return &lexicon.get_identifier(string(0));
+            case operator_cat:
+               return &lexicon.get_operator(string(0));
+            case conversion_cat:
+               return &lexicon.get_conversion(get<ipr::Type>(0));
+            case ctor_name_cat:
+               return &lexicon.get_ctor_name(get<ipr::Type>(0));
+            case dtor_name_cat:
+               return &lexicon.get_dtor_name(get<ipr::Type>(0));
+            case type_id_cat:
+               return lexicon.make_type_id(get<ipr::Type>(0));
+            case scope_ref_cat: {
+               auto& x = rep<impl::Scope_ref>
+                  (&lexicon.get_scope_ref(get<ipr::Expr>(0),
+                                          get<ipr::Expr>(1)));
+               if (arg(2) != none)
+                  x.constraint = &get<ipr::Type>(2);
+               return &x;
+            }
+            case template_id_cat: {
+               auto& x = rep<impl::Template_id>
+                  (&lexicon.get_template_id(get<ipr::Name>(0),
+                                            get<ipr::Expr_list>(1)));
+               if (arg(2) != none)
+                  x.constraint = &get<ipr::Type>(2);
+               return &x;
+            }
+
+            case array_cat:
+               return &lexicon.get_array(get<ipr::Type>(0),
+                                         get<ipr::Expr>(1));
+            case as_type_cat:
+               return &lexicon.get_as_type(get<ipr::Expr>(0),
+                                           get<ipr::Linkage>(1));
+            case decltype_cat:
+               return &lexicon.get_decltype(get<ipr::Expr>(0));
+            case function_cat:
+               return &lexicon.get_function(get<ipr::Product>(0),
+                                            get<ipr::Type>(1),
+                                            get<ipr::Sum>(2),
+                                            get<ipr::Linkage>(3));
+            case pointer_cat:
+               return &lexicon.get_pointer(get<ipr::Type>(0));
+            case reference_cat:
+               return &lexicon.get_reference(get<ipr::Type>(0));
+            case rvalue_reference_cat:
+               return &lexicon.get_rvalue_reference(get<ipr::Type>(0));
+            case ptr_to_member_cat:
+               return &lexicon.get_ptr_to_member(get<ipr::Type>(0),
+                                                 get<ipr::Type>(1));
+            case qualified_cat:
+               return &lexicon.get_qualified(ipr::Type_qualifier(arg(0)),
+                                             get<ipr::Type>(1));
+            case product_cat:
+               return &lexicon.get_product(types().data(), int(count));
+            case sum_cat:
+               return &lexicon.get_sum(types().data(), int(count));
+            case template_cat:
+               return &lexicon.get_template(get<ipr::Product>(0),
+                                            get<ipr::Type>(1));
+            case auto_cat:
+               return &lexicon.get_auto();
+
+            case class_cat:
+               return udt(lexicon.make_class(region(arg(0))));
+            case union_cat:
+               return udt(lexicon.make_union(region(arg(0))));
+            case namespace_cat:
+               return udt(lexicon.make_namespace(region(arg(0))));
+            case enum_cat:
+               return udt(lexicon.make_enum(region(arg(0)),
+                                            ipr::Enum::Kind(arg(3))));
+
+            case phantom_cat: {
+               impl::Phantom* x = lexicon.make_phantom();
+               x->constraint = get_opt<ipr::Type>(0);
+               return x;
+            }
+            case literal_cat:
+               return &lexicon.get_literal(get<ipr::Type>(0), string(1));
+            case expr_list_cat: {
+               impl::Expr_list* x = lexicon.make_expr_list();
+               for (Word i = 0; i < count; ++i)
+                  x->push_back(&get<ipr::Expr>(i));
+               return x;
+            }
+            case id_expr_cat: {
+               impl::Id_expr* x = lexicon.make_id_expr(get<ipr::Name>(0));
+               x->constraint = get_opt<ipr::Type>(1);
+               return x;
+            }
+            case sizeof_cat: {
+               impl::Sizeof* x = lexicon.make_sizeof(get<ipr::Expr>(0));
+               x->constraint = get_opt<ipr::Type>(1);
+               return x;
+            }
+            case typeid_cat: {
+               impl::Typeid* x = lexicon.make_typeid(get<ipr::Expr>(0));
+               x->constraint = get_opt<ipr::Type>(1);
+               return x;
+            }
+            case member_init_cat: {
+               impl::Member_init* x =
+                  lexicon.make_member_init(get<ipr::Expr>(0),
+                                           get<ipr::Expr>(1));
+               x->constraint = get_opt<ipr::Type>(2);
+               return x;
+            }
+            case paren_expr_cat: {
+               impl::Paren_expr* x = lexicon.make_paren_expr(get<ipr::Expr>(0));
+               implementation(x->op_impl, 1);
+               return x;
+            }
+            case conditional_cat: {
+               impl::Conditional* x =
+                  lexicon.make_conditional(get<ipr::Expr>(0),
+                                           get<ipr::Expr>(1),
+                                           get<ipr::Expr>(2));
+               x->constraint = get_opt<ipr::Type>(3);
+               implementation(x->op_impl, 4);
+               return x;
+            }
+            case new_cat: {
+               impl::New* x = lexicon.make_new(get<ipr::Type>(1));
+               x->where = get_opt<ipr::Expr_list>(0);
+               x->args = get_opt<ipr::Expr_list>(2);
+               x->constraint = get_opt<ipr::Type>(3);
+               implementation(x->op_impl, 4);
+               return x;
+            }
+            case mapping_cat: {
+               impl::Mapping* x = lexicon.F::make_mapping
+                  (region(arg(0)), get<ipr::Type>(2), arg(1));
+               x->constraint = get_opt<ipr::Type>(3);
+               x->value_type = get_opt<ipr::Type>(4);
+               return x;
+            }
+
+            case address_cat: return unary(&F::make_address);
+            case array_delete_cat: return unary(&F::make_array_delete);
+            case complement_cat: return unary(&F::make_complement);
+            case delete_cat: return unary(&F::make_delete);
+            case deref_cat: return unary(&F::make_deref);
+            case initializer_list_cat:
+               return unary(&F::make_initializer_list);
+            case not_cat: return unary(&F::make_not);
+            case post_decrement_cat: return unary(&F::make_post_decrement);
+            case post_increment_cat: return unary(&F::make_post_increment);
+            case pre_decrement_cat: return unary(&F::make_pre_decrement);
+            case pre_increment_cat: return unary(&F::make_pre_increment);
+            case throw_cat: return unary(&F::make_throw);
+            case unary_minus_cat: return unary(&F::make_unary_minus);
+            case unary_plus_cat: return unary(&F::make_unary_plus);
+            case expansion_cat: return unary(&F::make_expansion);
+
+            case plus_cat: return binary(&F::make_plus);
+            case plus_assign_cat: return binary(&F::make_plus_assign);
+            case and_cat: return binary(&F::make_and);
+            case array_ref_cat: return binary(&F::make_array_ref);
+            case arrow_cat: return binary(&F::make_arrow);
+            case arrow_star_cat: return binary(&F::make_arrow_star);
+            case assign_cat: return binary(&F::make_assign);
+            case bitand_cat: return binary(&F::make_bitand);
+            case bitand_assign_cat: return binary(&F::make_bitand_assign);
+            case bitor_cat: return binary(&F::make_bitor);
+            case bitor_assign_cat: return binary(&F::make_bitor_assign);
+            case bitxor_cat: return binary(&F::make_bitxor);
+            case bitxor_assign_cat: return binary(&F::make_bitxor_assign);
+            case call_cat: return binary(&F::make_call);
+            case comma_cat: return binary(&F::make_comma);
+            case div_cat: return binary(&F::make_div);
+            case div_assign_cat: return binary(&F::make_div_assign);
+            case dot_cat: return binary(&F::make_dot);
+            case dot_star_cat: return binary(&F::make_dot_star);
+            case equal_cat: return binary(&F::make_equal);
+            case greater_cat: return binary(&F::make_greater);
+            case greater_equal_cat: return binary(&F::make_greater_equal);
+            case less_cat: return binary(&F::make_less);
+            case less_equal_cat: return binary(&F::make_less_equal);
+            case lshift_cat: return binary(&F::make_lshift);
+            case lshift_assign_cat: return binary(&F::make_lshift_assign);
+            case modulo_cat: return binary(&F::make_modulo);
+            case modulo_assign_cat: return binary(&F::make_modulo_assign);
+            case mul_cat: return binary(&F::make_mul);
+            case mul_assign_cat: return binary(&F::make_mul_assign);
+            case not_equal_cat: return binary(&F::make_not_equal);
+            case or_cat: return binary(&F::make_or);
+            case rshift_cat: return binary(&F::make_rshift);
+            case rshift_assign_cat: return binary(&F::make_rshift_assign);
+            case minus_cat: return binary(&F::make_minus);
+            case minus_assign_cat: return binary(&F::make_minus_assign);
+
+            case cast_cat: return conversion(&F::make_cast);
+            case const_cast_cat: return conversion(&F::make_const_cast);
+            case datum_cat: return conversion(&F::make_datum);
+            case dynamic_cast_cat: return conversion(&F::make_dynamic_cast);
+            case reinterpret_cast_cat:
+               return conversion(&F::make_reinterpret_cast);
+            case static_cast_cat: return conversion(&F::make_static_cast);
+
+            case block_cat: {
+               impl::Block* x = lexicon.make_block(region(arg(0)),
+                                                   get<ipr::Type>(1));
+               common = x;
+               return x;
+            }
+            case break_cat: {
+               impl::Break* x = lexicon.make_break();
+               common = x;
+               return x;
+            }
+            case continue_cat: {
+               impl::Continue* x = lexicon.make_continue();
+               common = x;
+               return x;
+            }
+            case ctor_body_cat: {
+               impl::Ctor_body* x =
+                  lexicon.make_ctor_body(get<ipr::Expr_list>(0),
+                                         get<ipr::Block>(1));
+               x->constraint = get_opt<ipr::Type>(2);
+               common = x;
+               return x;
+            }
+            case do_cat: {
+               impl::Do* x = lexicon.make_do(get<ipr::Stmt>(1),
+                                             get<ipr::Expr>(0));
+               common = x;
+               return x;
+            }
+            case expr_stmt_cat:
+               if (count == 0) {
+                  impl::Empty_stmt* x = lexicon.make_empty_stmt();
+                  common = x;
+                  return x;
+               }
+               else {
+                  impl::Expr_stmt* x = lexicon.make_expr_stmt(get<ipr::Expr>(0));
+                  common = x;
+                  return x;
+               }
+            case for_cat: {
+               impl::For* x = lexicon.make_for();
+               x->init = get_opt<ipr::Expr>(0);
+               x->cond = get_opt<ipr::Expr>(1);
+               x->inc = get_opt<ipr::Expr>(2);
+               x->stmt = get_opt<ipr::Stmt>(3);
+               x->constraint = get_opt<ipr::Type>(4);
+               common = x;
+               return x;
+            }
+            case for_in_cat: {
+               impl::For_in* x = lexicon.make_for_in();
+               x->seq = get_opt<ipr::Expr>(0);
+               x->stmt = get_opt<ipr::Stmt>(1);
+               x->constraint = get_opt<ipr::Type>(2);
+               common = x;
+               return x;
+            }
+            case goto_cat: {
+               impl::Goto* x = lexicon.make_goto(get<ipr::Expr>(0));
+               common = x;
+               return x;
+            }
+            case return_cat: {
+               impl::Return* x = lexicon.make_return(get<ipr::Expr>(0));
+               common = x;
+               return x;
+            }
+            case handler_cat: {
+               impl::Handler* x = lexicon.make_handler(decl(0),
+                                                       get<ipr::Block>(1));
+               common = x;
+               return x;
+            }
+            case if_then_cat: return statement(&S::make_if_then);
+            case labeled_stmt_cat: return statement(&S::make_labeled_stmt);
+            case switch_cat: return statement(&S::make_switch);
+            case while_cat: return statement(&S::make_while);
+            case if_then_else_cat: {
+               impl::If_then_else* x =
+                  lexicon.make_if_then_else(get<ipr::Expr>(0),
+                                            get<ipr::Stmt>(1),
+                                            get<ipr::Stmt>(2));
+               x->constraint = get_opt<ipr::Type>(3);
+               common = x;
+               return x;
+            }
+
+            default:
+               corrupted();
+            }
+         }
+
+         // When merging, the earlier node of the unit that the record
+         // about to be read stands for, if any.
+         const ipr::Node*
+         Reader::adopt(Word tag)
+         {
+            const Word w = nodes.size();
+            auto p = pending.find(w);
+            if (p != pending.end()) {
+               const ipr::Node* n = p->second;
+               pending.erase(p);
+               if (Word(n->category) != tag)
+                  corrupted();
+               return n;
+            }
+            if (is_udt(tag))
+               return unify(w);
+            if (not is_decl(tag))
+               return nullptr;
+            at(arg(0));
+            if (sealed[arg(0)])
+               return keep(w, member(tag, arg(0)));
+            if (tag != typedecl_cat)
+               return nullptr;
+
+            // A typedecl stands for the earlier typedecl that defines
+            // the type its definition stands for.
+            const Word init = image.link(w, init_link);
+            if (init == none or not is_udt(image.node(init)[0]))
+               return nullptr;
+            const ipr::Node* t = init < w ? (kept[init] ? at(init) : nullptr)
+               : unify(init);
+            if (t == nullptr) {
+               auto c = conflicts.find(init);
+               if (c != conflicts.end()) {
+                  conflict = c->second;
+                  conflicts.erase(c);
+               }
+               return nullptr;
+            }
+            for (auto& m : region(arg(0)).bindings()[get<ipr::Name>(1)])
+               for (auto& d : m.decl_set()) {
+                  Optional<ipr::Expr> x = d.initializer();
+                  if (d.category == typedecl_cat and x and &x.get() == t) {
+                     kept[w] = true;
+                     return &d;
+                  }
+               }
+            return nullptr;
+         }
+
+         // The earlier member of a unified type that the next member
+         // record of that type stands for.  Unified types have members
+         // of the same content, thus in the same order.
+         const ipr::Decl&
+         Reader::member(Word tag, Word owner)
+         {
+            const ipr::Node& n = *at(owner);
+            const bool base = tag == base_type_cat;
+            const int i = ordinals[std::uint64_t(owner) << 1 | base]++;
+            const ipr::Decl* d = nullptr;
+            auto nth = [&](const auto& seq) {
+               if (i < seq.size())
+                  d = &seq[i];
+            };
+            if (base and n.category == class_cat)
+               nth(rep<ipr::Class>(n).bases());
+            else if (n.category == enum_cat)
+               nth(rep<ipr::Enum>(n).members());
+            else
+               nth(rep<ipr::Udt>(n).scope().members());
+            if (d == nullptr or Word(d->category) != tag)
+               corrupted();
+            return *d;
+         }
+
+         // Let the record with index W stand for the member D of a
+         // unified type.  If D defines a type, so does the type that W
+         // is initialized with.
+         const ipr::Node*
+         Reader::keep(Word w, const ipr::Decl& d)
+         {
+            kept[w] = true;
+            const Word init = image.link(w, init_link);
+            if (d.category != typedecl_cat or init == none or init < w)
+               return &d;
+            Optional<ipr::Expr> t = d.initializer();
+            if (t and image.node(init)[0] == Word(t.get().category)
+                and is_udt(t.get().category))
+               adopt(init, rep<ipr::Udt>(t.get()));
+            return &d;
+         }
+
+         // Let the type with index U stand for the type T of the unit.
+         // Members of a unified class, union or enumeration stand for
+         // the members of T; those of a namespace are added to it.
+         const ipr::Node*
+         Reader::adopt(Word u, const ipr::Udt& t)
+         {
+            kept[u] = true;
+            sealed[u] = t.category != namespace_cat;
+            if (u >= nodes.size())
+               pending[u] = &t;
+            return &t;
+         }
+
+         // The type of the unit that the named user-defined type with
+         // index U stands for: a namespace of the same name in the
+         // same scope, or a type of the same name whose members have
+         // the same content.
+         const ipr::Node*
+         Reader::unify(Word u)
+         {
+            const Word* r = image.node(u);
+            if (r[1] < 3 or r[2] >= nodes.size() or r[3] >= nodes.size())
+               return nullptr;
+            const ipr::Name& name = rep<ipr::Name>(*at(r[3]));
+            const ipr::Decl* first = nullptr;
+            for (auto& m : region(r[2]).bindings()[name])
+               for (auto& d : m.decl_set()) {
+                  if (d.category != typedecl_cat)
+                     continue;
+                  Optional<ipr::Expr> x = d.initializer();
+                  if (not x or Word(x.get().category) != r[0])
+                     continue;
+                  const ipr::Udt& t = rep<ipr::Udt>(x.get());
+                  if (r[0] == namespace_cat) {
+                     ++merger->report.namespaces;
+                     return adopt(u, t);
+                  }
+                  // A definition from this image is still incomplete,
+                  // and one of the same name that it kept apart.
+                  const ipr::Udt& y = rep<ipr::Udt>(view->node(u));
+                  if (t.node_id < mark
+                      and merger->hash.members(t) == incoming.members(y)) {
+                     ++merger->report.types;
+                     return adopt(u, t);
+                  }
+                  if (first == nullptr)
+                     first = &d;
+               }
+            if (first != nullptr)
+               conflicts[u] = first;
+            return nullptr;
+         }
+
+         // An initializer of a declaration, or the body of a mapping.
+         void
+         Reader::initialize()
+         {
+            if (is_kept(arg(0)))
+               return;
+            const ipr::Node* n = at(arg(0));
+            switch (n->category) {
+            case var_cat:
+               rep<impl::Var>(n).init = &get<ipr::Expr>(1);
+               break;
+            case field_cat:
+               rep<impl::Field>(n).init = &get<ipr::Expr>(1);
+               break;
+            case bitfield_cat:
+               rep<impl::Bitfield>(n).init = &get<ipr::Expr>(1);
+               break;
+            case enumerator_cat:
+               rep<impl::Enumerator>(n).init = &get<ipr::Expr>(1);
+               break;
+            case parameter_cat:
+               rep<impl::Parameter>(n).init = &get<ipr::Expr>(1);
+               break;
+            case typedecl_cat:
+               rep<impl::Typedecl>(n).init = &get<ipr::Type>(1);
+               break;
+            case fundecl_cat: case named_map_cat: {
+               const ipr::Node* m = at(arg(1));
+               if (m->category != mapping_cat)
+                  corrupted();
+               if (n->category == fundecl_cat)
+                  rep<impl::Fundecl>(n).init = &rep<impl::Mapping>(m);
+               else
+                  rep<impl::Named_map>(n).init = &rep<impl::Mapping>(m);
+               break;
+            }
+            case mapping_cat:
+               rep<impl::Mapping>(n).body = &get<ipr::Expr>(1);
+               break;
+            default:
+               corrupted();
+            }
+         }
+
+         // A reference to a node defined after its referrer.
+         void
+         Reader::fixup()
+         {
+            const ipr::Node* n = at(arg(0));
+            switch (n->category) {
+            case id_expr_cat:
+               rep<impl::Id_expr>(n).decl = &decl(1);
+               break;
+            case break_cat:
+               rep<impl::Break>(n).stmt = &get<ipr::Stmt>(1);
+               break;
+            case continue_cat:
+               rep<impl::Continue>(n).stmt = &get<ipr::Stmt>(1);
+               break;
+            case for_in_cat:
+               if (decl(1).category != var_cat)
+                  corrupted();
+               rep<impl::For_in>(n).var = &get<ipr::Var>(1);
+               break;
+            default: {
+               auto p = impls.find(arg(0));
+               if (p == impls.end())
+                  corrupted();
+               *p->second = &decl(1);
+               impls.erase(p);
+               break;
+            }
+            }
+         }
+
+         void
+         Reader::body()
+         {
+            const ipr::Node* n = at(arg(0));
+            if (n->category != block_cat)
+               corrupted();
+            impl::Block& block = rep<impl::Block>(n);
+            const Word nstmts = arg(1);
+            for (Word i = 0; i < nstmts; ++i)
+               block.add_stmt(&get<ipr::Stmt>(2 + i));
+            const Word nhandlers = arg(2 + nstmts);
+            for (Word i = 0; i < nhandlers; ++i)
+               block.add_handler(&get<ipr::Handler>(3 + nstmts + i));
+         }
+
+         void
+         Reader::locus()
+         {
+            const Word w = arg(0);
+            at(w);
+            if (is_kept(w))
+               return;
+            impl::Stmt_common* s = commons[w];
+            if (s == nullptr)
+               corrupted();
+            s->src_locus.line = ipr::Line_number(arg(1));
+            s->src_locus.column = ipr::Column_number(arg(2));
+            s->src_locus.file = ipr::File_index(arg(3));
+            s->unit_locus.line = ipr::Line_number(arg(4));
+            s->unit_locus.column = ipr::Column_number(arg(5));
+            s->unit_locus.unit = ipr::Unit_index(arg(6));
+         }
+      }
+
+      // -- Mapped_file --
+      Mapped_file::Mapped_file(const std::string& path)
+            : base{ }, length{ }
+      {
+#ifdef IPR_IMAGE_MMAP
+         const int fd = ::open(path.c_str(), O_RDONLY);
+         if (fd < 0)
+            throw std::domain_error("ipr::image: cannot open " + path);
+         struct stat st;
+         if (::fstat(fd, &st) == 0 and st.st_size > 0) {
+            void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE,
+                             fd, 0);
+            if (p != MAP_FAILED) {
+               base = p;
+               length = st.st_size;
+            }
+         }
+         ::close(fd);
+         if (base != nullptr)
+            return;
+#endif
+         std::ifstream is(path, std::ios::binary);
+         if (not is)
+            throw std::domain_error("ipr::image: cannot open " + path);
+         buffer.assign(std::istreambuf_iterator<char>(is),
+                       std::istreambuf_iterator<char>());
+         base = buffer.data();
+         length = buffer.size();
+      }
+
+      Mapped_file::~Mapped_file()
+      {
+#ifdef IPR_IMAGE_MMAP
+         if (base != nullptr and base != buffer.data())
+            ::munmap(const_cast<void*>(base), length);
+#endif
+      }
+
+      // -- Image --
+      Image::Image(const void* p, std::size_t n)
+      {
+         if (p == nullptr or n < sizeof(Header)
+             or reinterpret_cast<std::uintptr_t>(p) % alignof(Word) != 0)
+            corrupted();
+         header = static_cast<const Header*>(p);
+         if (std::memcmp(header->magic, magic, sizeof magic) != 0
+             or header->version != version)
+            throw std::domain_error("ipr::image: not an image");
+         if (header->byte_order != byte_order)
+            throw std::domain_error("ipr::image: foreign byte order");
+
+         const std::uint64_t padded =
+            (std::uint64_t(header->string_bytes) + sizeof(Word) - 1)
+            / sizeof(Word) * sizeof(Word);
+         const std::uint64_t total = sizeof(Header) + padded
+            + sizeof(Word) * (std::uint64_t(header->string_count)
+                              + header->node_count + header->word_count
+                              + std::uint64_t(header->node_count) * link_count
+                              + header->node_count + 1
+                              + header->member_count);
+         if (total != n)
+            corrupted();
+
+         string_ends = reinterpret_cast<const Word*>(header + 1);
+         chars = reinterpret_cast<const char*>
+            (string_ends + header->string_count);
+         offsets = reinterpret_cast<const Word*>(chars + padded);
+         records = offsets + header->node_count;
+         links = records + header->word_count;
+         member_starts = links + std::size_t(header->node_count) * link_count;
+         member_list = member_starts + header->node_count + 1;
+      }
+
+      Image::Text
+      Image::string(int i) const
+      {
+         if (i < 0 or i >= string_count())
+            corrupted();
+         const Word first = i == 0 ? 0 : string_ends[i - 1];
+         const Word last = string_ends[i];
+         if (first > last or last > header->string_bytes)
+            corrupted();
+         return { chars + first, int(last - first) };
+      }
+
+      const Image::Word*
+      Image::node(int i) const
+      {
+         if (i < 0 or i >= node_count() or offsets[i] >= header->word_count)
+            corrupted();
+         return records + offsets[i];
+      }
+
+      const Image::Word*
+      Image::record(Word offset) const
+      {
+         if (offset >= header->word_count)
+            corrupted();
+         return records + offset;
+      }
+
+      Image::Word
+      Image::link(int i, Link l) const
+      {
+         if (i < 0 or i >= node_count())
+            corrupted();
+         return links[std::size_t(i) * link_count + l];
+      }
+
+      std::pair<const Image::Word*, const Image::Word*>
+      Image::members(int i) const
+      {
+         if (i < 0 or i >= node_count())
+            corrupted();
+         const Word first = member_starts[i];
+         const Word last = member_starts[i + 1];
+         if (first > last or last > header->member_count)
+            corrupted();
+         return { member_list + first, member_list + last };
+      }
+
+      void
+      save(std::ostream& os, const ipr::Lexicon& lexicon,
+           const ipr::Translation_unit& unit)
+      {
+         Writer(lexicon, unit).write(os);
+      }
+
+      void
+      save(const std::string& path, const ipr::Lexicon& lexicon,
+           const ipr::Translation_unit& unit)
+      {
+         Writer writer(lexicon, unit);
+         std::ofstream os(path, std::ios::binary);
+         if (not os)
+            throw std::domain_error("ipr::image: cannot create " + path);
+         writer.write(os);
+      }
+
+      int
+      restore(const Image& image, impl::Lexicon& lexicon,
+              impl::Translation_unit& unit)
+      {
+         return Reader(image, lexicon, unit).run();
+      }
+
+      int
+      restore(const std::string& path, impl::Lexicon& lexicon,
+              impl::Translation_unit& unit)
+      {
+         const Mapped_file file(path);
+         return restore(Image(file), lexicon, unit);
+      }
+
+      int
+      compact(const ipr::Lexicon& from, const ipr::Translation_unit& unit,
+              impl::Lexicon& lexicon, impl::Translation_unit& into)
+      {
+         std::ostringstream os;
+         save(os, from, unit);
+         const std::string bytes = os.str();
+         return restore(Image(bytes.data(), bytes.size()), lexicon, into);
+      }
+
+      namespace {
+         void
+         merge_one(const Image* image, Merger& m, impl::Lexicon& lexicon,
+                   impl::Translation_unit& unit)
+         {
+            m.report.nodes += Reader(*image, lexicon, unit, &m).run();
+         }
+
+         void
+         merge_one(const std::string& path, Merger& m,
+                   impl::Lexicon& lexicon, impl::Translation_unit& unit)
+         {
+            const Mapped_file file(path);
+            const Image image(file);
+            merge_one(&image, m, lexicon, unit);
+         }
+
+         void
+         merge_one(const Source& s, Merger& m, impl::Lexicon& lexicon,
+                   impl::Translation_unit& unit)
+         {
+            std::ostringstream os;
+            save(os, s.lexicon, s.unit);
+            const std::string bytes = os.str();
+            const Image image(bytes.data(), bytes.size());
+            merge_one(&image, m, lexicon, unit);
+         }
+
+         // Partitions of the inputs are merged concurrently, each into
+         // a Lexicon of its own; the images of the partial units are
+         // then merged into the unit, in order.  A partition holds at
+         // least two inputs, lest it only add a save and a restore.
+         template<class T>
+         Merge_report
+         merge_all(const std::vector<T>& inputs, impl::Lexicon& lexicon,
+                   impl::Translation_unit& unit, const Merge_options& options)
+         {
+            const int n = inputs.size();
+            int partitions = options.partitions > 0 ? options.partitions
+               : int(std::thread::hardware_concurrency());
+            partitions = std::min(partitions, n / 2);
+
+            Merger merger;
+            if (partitions <= 1) {
+               for (auto& x : inputs)
+                  merge_one(x, merger, lexicon, unit);
+            }
+            else {
+               std::vector<std::string> images(partitions);
+               std::vector<Merge_report> reports(partitions);
+               std::vector<std::exception_ptr> errors(partitions);
+               std::vector<std::thread> threads;
+               for (int i = 0; i < partitions; ++i)
+                  threads.emplace_back([&, i] {
+                        try {
+                           impl::Lexicon lex;
+                           impl::Translation_unit partial { lex };
+                           Merger m;
+                           for (int j = n * i / partitions;
+                                j < n * (i + 1) / partitions; ++j)
+                              merge_one(inputs[j], m, lex, partial);
+                           std::ostringstream os;
+                           save(os, lex, partial);
+                           images[i] = os.str();
+                           reports[i] = std::move(m.report);
+                        }
+                        catch (...) {
+                           errors[i] = std::current_exception();
+                        }
+                     });
+               for (auto& t : threads)
+                  t.join();
+               for (auto& e : errors)
+                  if (e)
+                     std::rethrow_exception(e);
+
+               // Conflicts within a partition are kept apart in its
+               // image, and found again by the final merge.
+               for (int i = 0; i < partitions; ++i) {
+                  const Image image(images[i].data(), images[i].size());
+                  merge_one(&image, merger, lexicon, unit);
+                  merger.report.namespaces += reports[i].namespaces;
+                  merger.report.types += reports[i].types;
+               }
+            }
+            merger.report.units = n;
+            return std::move(merger.report);
+         }
+      }
+
+      Merge_report
+      merge(const std::vector<const Image*>& images, impl::Lexicon& lexicon,
+            impl::Translation_unit& unit, const Merge_options& options)
+      {
+         return merge_all(images, lexicon, unit, options);
+      }
+
+      Merge_report
+      merge(const std::vector<std::string>& paths, impl::Lexicon& lexicon,
+            impl::Translation_unit& unit, const Merge_options& options)
+      {
+         return merge_all(paths, lexicon, unit, options);
+      }
+
+      Merge_report
+      merge(const std::vector<Source>& sources, impl::Lexicon& lexicon,
+            impl::Translation_unit& unit, const Merge_options& options)
+      {
+         return merge_all(sources, lexicon, unit, options);
+      }
+   }
+}
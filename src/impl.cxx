@@ -15,35 +15,309 @@
 #include <utility>
 #include <cstring>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 namespace ipr {
    namespace impl {
 
-      Token::Token(const ipr::String& s, const Source_location& l,
-                   TokenValue v, TokenCategory c)
-            : text{ s }, location{ l }, token_value{ v }, token_category{ c }
-      { }
+      // ------------------------
+      // -- impl::unit_storage --
+      // ------------------------
 
-      const ipr::Sequence<ipr::Identifier>& Module_name::stems() const {
-         return components;
+      // The storage active in this thread.
+      static thread_local unit_storage* current_storage = nullptr;
+
+      unit_storage::~unit_storage()
+      {
+         if (activated)
+            deactivate();
+         clear();
       }
 
-      struct scope_datum::comp {
-         int operator()(const scope_datum& lhs, const scope_datum& rhs) const
+      unit_storage*
+      unit_storage::active()
+      {
+         return current_storage;
+      }
+
+      void
+      unit_storage::activate()
+      {
+         if (activated)
+            throw std::logic_error("unit_storage already active");
+         previous = current_storage;
+         if (previous != nullptr)
+            previous->close_span();
+         current_storage = this;
+         activated = true;
+         open_span();
+      }
+
+      void
+      unit_storage::deactivate()
+      {
+         if (current_storage == this) {
+            close_span();
+            if (previous != nullptr)
+               previous->open_span();
+         }
+         for (unit_storage** p = &current_storage; *p != nullptr;
+              p = &(*p)->previous)
+            if (*p == this) {
+               *p = previous;
+               break;
+            }
+         previous = nullptr;
+         activated = false;
+      }
+
+      unit_storage::Pause::Pause() : saved(current_storage)
+      {
+         if (saved != nullptr)
+            saved->close_span();
+         current_storage = nullptr;
+      }
+
+      unit_storage::Pause::~Pause()
+      {
+         current_storage = saved;
+         if (saved != nullptr)
+            saved->open_span();
+      }
+
+      void
+      unit_storage::open_span()
+      {
+         first_id = stats::all_nodes_count();
+      }
+
+      // A span follows the previous one if no node was made between.
+      void
+      unit_storage::close_span()
+      {
+         const int last = stats::all_nodes_count();
+         if (last == first_id)
+            return;
+         if (not made.empty() and made.back().second == first_id)
+            made.back().second = last;
+         else
+            made.push_back({ first_id, last });
+      }
+
+      // Objects larger than a quarter of a block get a block of their
+      // own, pushed after the current one, which stays current.
+      void*
+      unit_storage::allocate(std::size_t n, std::size_t a)
+      {
+         if (n > block_size / 4) {
+            blocks.push_back({ std::unique_ptr<char[]>(new char[n]), n, true });
+            return blocks.back().store.get();
+         }
+         auto p = reinterpret_cast<char*>
+            ((reinterpret_cast<std::uintptr_t>(next) + a - 1) & ~(a - 1));
+         if (next == nullptr or p + n > limit) {
+            blocks.push_back({ std::unique_ptr<char[]>(new char[block_size]),
+                               block_size, false });
+            p = blocks.back().store.get();
+            limit = p + block_size;
+         }
+         next = p + n;
+         return p;
+      }
+
+      // Give back the space of the latest object, at P, given the free
+      // space TOP before it was allocated.  A block left empty is freed,
+      // and allocation resumes at TOP in the previous one.
+      void
+      unit_storage::retract(void* p, char* top)
+      {
+         if (blocks.back().dedicated and blocks.back().store.get() == p) {
+            blocks.pop_back();
+            return;
+         }
+         auto current = std::find_if(blocks.rbegin(), blocks.rend(),
+                                     [](const Block& b) {
+                                        return not b.dedicated;
+                                     });
+         char* const first = current->store.get();
+         if (top >= first and top <= first + current->size) {
+            next = top;
+            return;
+         }
+         blocks.erase(std::next(current).base());
+         next = limit = nullptr;
+         for (auto i = blocks.rbegin(); i != blocks.rend(); ++i)
+            if (not i->dedicated) {
+               next = top;
+               limit = i->store.get() + i->size;
+               break;
+            }
+      }
+
+      void
+      unit_storage::undo_make(void* self, std::uintptr_t)
+      {
+         unit_storage* u = static_cast<unit_storage*>(self);
+         const Object x = u->objects.back();
+         u->objects.pop_back();
+         x.destroy(x.where);
+         u->retract(x.where, x.top);
+      }
+
+      std::vector<unit_storage::Extent>
+      unit_storage::extents() const
+      {
+         std::vector<Extent> v;
+         for (auto& b : blocks)
+            v.emplace_back(b.store.get(), b.store.get() + b.size);
+         std::sort(v.begin(), v.end());
+         return v;
+      }
+
+      std::size_t
+      unit_storage::memory() const
+      {
+         std::size_t n = objects.capacity() * sizeof (Object)
+            + blocks.capacity() * sizeof (Block);
+         for (auto& b : blocks)
+            n += b.size;
+         return n;
+      }
+
+      void
+      unit_storage::clear()
+      {
+         while (not objects.empty()) {
+            objects.back().destroy(objects.back().where);
+            objects.pop_back();
+         }
+         std::vector<Object>().swap(objects);
+         std::vector<Block>().swap(blocks);
+         std::vector<Span>().swap(made);
+         next = limit = nullptr;
+      }
+
+      // ----------------------
+      // -- impl::node_sweep --
+      // ----------------------
+
+      // Whether the nodes of category C are unified by a Lexicon.
+      static bool
+      unified(ipr::Category_code c)
+      {
+         switch (c) {
+         case ipr::string_cat: case ipr::linkage_cat:
+         case ipr::identifier_cat: case ipr::operator_cat:
+         case ipr::conversion_cat: case ipr::ctor_name_cat:
+         case ipr::dtor_name_cat: case ipr::rname_cat:
+         case ipr::scope_ref_cat: case ipr::template_id_cat:
+         case ipr::type_id_cat: case ipr::literal_cat:
+         case ipr::sizeof_cat: case ipr::typeid_cat:
+         case ipr::array_cat: case ipr::decltype_cat:
+         case ipr::as_type_cat: case ipr::function_cat:
+         case ipr::pointer_cat: case ipr::product_cat:
+         case ipr::ptr_to_member_cat: case ipr::qualified_cat:
+         case ipr::reference_cat: case ipr::rvalue_reference_cat:
+         case ipr::sum_cat: case ipr::template_cat:
+            return true;
+         default:
+            return false;
+         }
+      }
+
+      // The nodes about to be destroyed: those in some blocks of
+      // memory, and the unified nodes removed from the tables because
+      // they are made of such nodes.  Those are tested by address only,
+      // as they may be destroyed already.  For the registry, also the
+      // non-unified nodes made in some spans of node_ids; they are
+      // still alive then.
+      struct node_sweep : ipr::Node_registry::Filter {
+         std::vector<unit_storage::Extent> extents;
+         std::vector<unit_storage::Span> spans;
+         std::unordered_set<const void*> doomed;
+         std::vector<int> ids;      // of the doomed nodes
+         bool progress = false;
+
+         bool operator()(const ipr::Node& x) const override
          {
-            return compare(lhs.scope_pos, rhs.scope_pos);
+            if (doomed.count(&x) != 0 or within(&x))
+               return true;
+            auto s = std::upper_bound
+               (spans.begin(), spans.end(), x.node_id,
+                [](int id, const unit_storage::Span& y) {
+                   return id < y.first;
+                });
+            return s != spans.begin() and x.node_id < std::prev(s)->second
+               and not unified(x.category);
          }
 
-         int operator()(int pos, const scope_datum& s) const
+         bool within(const void* p) const
          {
-            return compare(pos, s.scope_pos);
+            const char* a = static_cast<const char*>(p);
+            auto e = std::upper_bound
+               (extents.begin(), extents.end(), a,
+                [](const char* x, const unit_storage::Extent& y) {
+                   return x < y.first;
+                });
+            return e != extents.begin() and a < std::prev(e)->second;
          }
 
-         int operator()(const scope_datum& s, int pos) const
+         // Whether X is doomed.  A node of the blocks is still alive
+         // the first time it is met; its node_id is noted then.
+         bool dead(const ipr::Node& x)
          {
-            return compare(s.scope_pos, pos);
+            if (doomed.count(&x) != 0)
+               return true;
+            if (not within(&x))
+               return false;
+            doomed.insert(&x);
+            ids.push_back(x.node_id);
+            return true;
+         }
+
+         // Remove the nodes of a table that have a doomed operand.
+         template<class T, class A>
+         void sweep(util::rb_tree::container<T, A>& table)
+         {
+            auto made_of_dead = [this](const T& x) {
+               bool result = false;
+               for_each_operand(x, [&](const ipr::Node& y) {
+                     if (dead(y))
+                        result = true;
+                  });
+               if (result) {
+                  doomed.insert(&x);
+                  ids.push_back(x.node_id);
+               }
+               return result;
+            };
+            if (table.erase_if(made_of_dead) != 0)
+               progress = true;
+         }
+
+         // Remove the sequences that have a doomed element.
+         template<class T, class A>
+         void sweep(util::rb_tree::container<ref_sequence<T>, A>& table)
+         {
+            table.erase_if([this](const ref_sequence<T>& s) {
+                  for (auto& x : s)
+                     if (dead(x))
+                        return true;
+                  return false;
+               });
          }
       };
 
+      Token::Token(const ipr::String& s, const Source_location& l,
+                   TokenValue v, TokenCategory c)
+            : text{ s }, location{ l }, token_value{ v }, token_category{ c }
+      { }
+
+      const ipr::Sequence<ipr::Identifier>& Module_name::stems() const {
+         return components;
+      }
+
       // -- impl::New --
       New::New(const ipr::Expr_list* where, const ipr::Type& what,
                const ipr::Expr_list* args)
@@ -73,18 +347,56 @@ namespace ipr {
 
       int
       decl_sequence::size() const {
-         return decls.size();
+         return count;
       }
 
       const ipr::Decl&
       decl_sequence::get(int i) const {
-         scope_datum* result = decls.find(i, scope_datum::comp());
-         return *util::check(result)->decl;
+         if (i < 0 || i >= count)
+            throw std::domain_error("decl_sequence::get");
+         if (frozen)
+            return *flat[i];
+         scope_datum* result = chunks[i / chunk_size][i % chunk_size];
+         return *util::check(util::check(result)->decl);
       }
 
       void
       decl_sequence::insert(scope_datum* s) {
-         decls.insert(s, scope_datum::comp());
+         check_thawed(frozen, "decl_sequence::insert");
+         if (s->scope_pos < 0)
+            s->scope_pos = count;
+
+         const int pos = s->scope_pos;
+         while (chunks.size() <= std::size_t(pos / chunk_size))
+            chunks.emplace_back(new scope_datum*[chunk_size]());
+         chunks[pos / chunk_size][pos % chunk_size] = s;
+         util::log_undo(&decl_sequence::undo_insert, this, count);
+         if (pos >= count)
+            count = pos + 1;
+      }
+
+      // Declarations are inserted at the end; restore the earlier
+      // count, and give back the chunks no longer used.
+      void
+      decl_sequence::undo_insert(void* self, std::uintptr_t n) {
+         decl_sequence* s = static_cast<decl_sequence*>(self);
+         for (int i = int(n); i < s->count; ++i)
+            s->chunks[i / chunk_size][i % chunk_size] = nullptr;
+         s->count = int(n);
+         const std::size_t used = (s->count + chunk_size - 1) / chunk_size;
+         while (s->chunks.size() > used)
+            s->chunks.pop_back();
+      }
+
+      void
+      decl_sequence::freeze() {
+         if (frozen)
+            return;
+         flat.reserve(count);
+         for (int i = 0; i < count; ++i)
+            flat.push_back(&get(i));
+         std::vector<Chunk>().swap(chunks);
+         frozen = true;
       }
 
       // --------------------
@@ -113,14 +425,31 @@ namespace ipr {
 
       impl::overload_entry*
       Overload::lookup(const ipr::Type& t) const {
+         if (frozen)
+            return by_type.find(t.node_id);
          return  entries.find(t, node_compare());
       }
 
       template<class T>
       void
       Overload::push_back(master_decl_data<T>* data) {
+         check_thawed(frozen, "Overload::push_back");
          entries.insert(data, node_compare());
          masters.push_back(data);
+         util::log_undo(&util::undo_push_back<std::vector<scope_datum*>>,
+                        &masters);
+      }
+
+      void
+      Overload::freeze() {
+         if (frozen)
+            return;
+         by_type.reserve(entries.size());
+         entries.for_each([this](overload_entry* e) {
+               e->declset.freeze();
+               by_type.insert(e->type.node_id, e);
+            });
+         frozen = true;
       }
 
       // ------------------------
@@ -801,6 +1130,14 @@ namespace ipr {
             return compare(lhs, rhs);
          }
 
+         // A unary node is keyed by its operand, so that a table holds
+         // one node per operand.
+         template<class T>
+         int operator()(const ipr::Node& lhs, const Unary<T>& rhs) const
+         {
+            return compare(lhs, rhs.rep);
+         }
+
          template<class T>
          int operator()(const node_ref<T>& lhs, const ipr::Node& rhs) const
          {
@@ -898,6 +1235,92 @@ namespace ipr {
 	  };
       // <<<< Yuriy Solodkyy: 2008/07/10 
 
+      // Compare N types, given by an array of pointers, with a
+      // sequence of types in the order of unary_compare, so that
+      // products and sums can be searched for without first building
+      // a sequence.
+      struct span_compare {
+         const ipr::Type* const* first;
+         int count;
+
+         int order(const ipr::Sequence<ipr::Type>& rhs) const
+         {
+            return util::lexicographical_compare()
+               (first, first + count, rhs.begin(), rhs.end(),
+                [](const ipr::Type* x, const ipr::Type& y) {
+                   return compare(*x, y);
+                });
+         }
+
+         template<class T>
+         int operator()(const span_compare&, const Unary<T>& rhs) const
+         {
+            return order(rhs.rep);
+         }
+      };
+
+      type_factory::Derived&
+      type_factory::derived_from(const ipr::Type& t)
+      {
+         if (Derived** p = derived.find(t))
+            return **p;
+         Derived*& d = derived[t];
+         if (spare.empty()) {
+            // The links are shared by all units.
+            unit_storage::Pause shared;
+            d = derivations.make();
+         }
+         else {
+            d = spare.back();
+            spare.pop_back();
+            *d = Derived();
+            util::log_undo(&type_factory::undo_spare, this,
+                           std::uintptr_t(d));
+         }
+         util::log_undo(&type_factory::undo_derived, this, t.node_id);
+         return *d;
+      }
+
+      void
+      type_factory::undo_spare(void* self, std::uintptr_t d)
+      {
+         static_cast<type_factory*>(self)->spare.push_back
+            (reinterpret_cast<Derived*>(d));
+      }
+
+      void
+      type_factory::sweep(node_sweep& s)
+      {
+         s.sweep(arrays);
+         s.sweep(decltypes);
+         s.sweep(type_refs);
+         s.sweep(functions);
+         s.sweep(pointers);
+         s.sweep(products);
+         s.sweep(member_ptrs);
+         s.sweep(qualifieds);
+         s.sweep(references);
+         s.sweep(refrefs);
+         s.sweep(sums);
+         s.sweep(templates);
+      }
+
+      void
+      type_factory::forget_derived(const std::vector<int>& ids)
+      {
+         for (int n : ids)
+            if (Derived** d = derived.find(n)) {
+               spare.push_back(*d);
+               derived.erase(n);
+            }
+      }
+
+      void
+      type_factory::undo_derived(void* self, std::uintptr_t n)
+      {
+         static_cast<type_factory*>(self)->derived.erase(int(n));
+      }
+
       impl::Array*
       type_factory::make_array(const ipr::Type& t, const ipr::Expr& b)
       {
@@ -915,7 +1338,16 @@ namespace ipr {
                ("type_factoy::make_qualified: no qualifier");
 
          using rep = impl::Qualified::Rep;
-         return qualifieds.insert(rep{ cv, t }, binary_compare());
+         const auto bits = std::size_t(cv);
+         if (bits >= std::extent<decltype(Derived::qualified)>::value)
+            return qualifieds.insert(rep{ cv, t }, binary_compare());
+
+         impl::Qualified*& q = derived_from(t).qualified[bits];
+         if (q == nullptr) {
+            q = qualifieds.insert(rep{ cv, t }, binary_compare());
+            util::log_undo(&util::undo_set<impl::Qualified>, &q);
+         }
+         return q;
       }
 
 
@@ -991,7 +1423,12 @@ namespace ipr {
       {
          // >>>> Yuriy Solodkyy: 2008/07/10 
          // Fixed pointer comparison for unification
-         return pointers.insert(t, unified_type_compare());
+         impl::Pointer*& p = derived_from(t).pointer;
+         if (p == nullptr) {
+            p = pointers.insert(t, unified_type_compare());
+            util::log_undo(&util::undo_set<impl::Pointer>, &p);
+         }
+         return p;
          // <<<< Yuriy Solodkyy: 2008/07/10 
       }
 
@@ -1009,12 +1446,36 @@ namespace ipr {
 
       impl::Reference*
       type_factory::make_reference(const ipr::Type& t) {
-         return references.insert(t, unified_type_compare());
+         impl::Reference*& r = derived_from(t).reference;
+         if (r == nullptr) {
+            r = references.insert(t, unified_type_compare());
+            util::log_undo(&util::undo_set<impl::Reference>, &r);
+         }
+         return r;
       }
 
       impl::Rvalue_reference*
       type_factory::make_rvalue_reference(const ipr::Type& t) {
-         return refrefs.insert(t, unified_type_compare());
+         impl::Rvalue_reference*& r = derived_from(t).refref;
+         if (r == nullptr) {
+            r = refrefs.insert(t, unified_type_compare());
+            util::log_undo(&util::undo_set<impl::Rvalue_reference>, &r);
+         }
+         return r;
+      }
+
+      impl::Product*
+      type_factory::find_product(const ipr::Type* const* t, int n) const
+      {
+         const span_compare key{ t, n };
+         return products.find(key, key);
+      }
+
+      impl::Sum*
+      type_factory::find_sum(const ipr::Type* const* t, int n) const
+      {
+         const span_compare key{ t, n };
+         return sums.find(key, key);
       }
 
       impl::Sum*
@@ -1144,11 +1605,48 @@ namespace ipr {
          return decls.seq;
       }
 
+      // The result of looking up a name that no scope declares.
+      static const empty_overload&
+      no_overload()
+      {
+         static const empty_overload missing { };
+         return missing;
+      }
+
       const ipr::Overload&
       Scope::operator[](const ipr::Name& n) const {
-         if (impl::Overload* ovl = overloads.find(n, node_compare()))
+         if (table == nullptr)
+            return no_overload();
+         impl::Overload* ovl = frozen ? table->by_name.find(n.node_id)
+            : table->overloads.find(n, node_compare());
+         if (ovl != nullptr)
             return *ovl;
-         return missing;
+         return no_overload();
+      }
+
+      impl::Overload*
+      Scope::overload_set(const ipr::Name& n) {
+         check_thawed(frozen, "Scope::declare");
+         if (table == nullptr) {
+            ipr::Node_registry::Recording recording { owner };
+            table.reset(new Table);
+         }
+         return table->overloads.insert(n, node_compare());
+      }
+
+      void
+      Scope::freeze() {
+         if (frozen)
+            return;
+         decls.seq.freeze();
+         if (table != nullptr) {
+            table->by_name.reserve(table->overloads.size());
+            table->overloads.for_each([this](impl::Overload& o) {
+                  o.freeze();
+                  table->by_name.insert(o.name.node_id, &o);
+               });
+         }
+         frozen = true;
       }
 
       template<class T>
@@ -1160,17 +1658,17 @@ namespace ipr {
 
       impl::Alias*
       Scope::make_alias(const ipr::Name& n, const ipr::Expr& i) {
-         impl::Overload* ovl = overloads.insert(n, node_compare());
+         impl::Overload* ovl = overload_set(n);
          overload_entry* master = ovl->lookup(i.type());
 
          if (master == 0) {
-            impl::Alias* decl = aliases.declare(ovl, i.type());
+            impl::Alias* decl = table->aliases.declare(ovl, i.type());
             decl->aliasee = &i;
             add_member(decl);
             return decl;
          }
          else {
-            impl::Alias* decl = aliases.redeclare(master);
+            impl::Alias* decl = table->aliases.redeclare(master);
             decl->aliasee = &i;
             add_member(decl);
             return decl;
@@ -1179,16 +1677,16 @@ namespace ipr {
 
       impl::Var*
       Scope::make_var(const ipr::Name& n, const ipr::Type& t) {
-         impl::Overload* ovl = overloads.insert(n, node_compare());
+         impl::Overload* ovl = overload_set(n);
          overload_entry* master = ovl->lookup(t);
 
          if (master == 0) {
-            impl::Var* var = vars.declare(ovl, t);
+            impl::Var* var = table->vars.declare(ovl, t);
             add_member(var);
             return var;
          }
          else {
-            impl::Var* var = vars.redeclare(master);
+            impl::Var* var = table->vars.redeclare(master);
             add_member(var);
             return var;
          }
@@ -1196,16 +1694,16 @@ namespace ipr {
 
       impl::Field*
       Scope::make_field(const ipr::Name& n, const ipr::Type& t) {
-         impl::Overload* ovl = overloads.insert(n, node_compare());
+         impl::Overload* ovl = overload_set(n);
          overload_entry* master = ovl->lookup(t);
 
          if (master == 0) {
-            impl::Field* field = fields.declare(ovl, t);
+            impl::Field* field = table->fields.declare(ovl, t);
             add_member(field);
             return field;
          }
          else {
-            impl::Field* field = fields.redeclare(master);
+            impl::Field* field = table->fields.redeclare(master);
             add_member(field);
             return field;
          }
@@ -1213,16 +1711,16 @@ namespace ipr {
 
       impl::Bitfield*
       Scope::make_bitfield(const ipr::Name& n, const ipr::Type& t) {
-         impl::Overload* ovl = overloads.insert(n, node_compare());
+         impl::Overload* ovl = overload_set(n);
          overload_entry* master = ovl->lookup(t);
 
          if (master == 0) {
-            impl::Bitfield* field = bitfields.declare(ovl, t);
+            impl::Bitfield* field = table->bitfields.declare(ovl, t);
             add_member(field);
             return field;
          }
          else {
-            impl::Bitfield* field = bitfields.redeclare(master);
+            impl::Bitfield* field = table->bitfields.redeclare(master);
             add_member(field);
             return field;
          }
@@ -1233,15 +1731,15 @@ namespace ipr {
       Scope::make_typedecl(const ipr::Name& n, const ipr::Type& t)
       {
          // Get the overload-set for this name.
-         impl::Overload* ovl = overloads.insert(n, node_compare());
+         impl::Overload* ovl = overload_set(n);
 
          // Does the overload-set already contain a decl with that type?
          overload_entry* master = ovl->lookup(t);
          impl::Typedecl* decl;
          if (master == 0)       // no, this is the first declaration
-             decl = typedecls.declare(ovl, t);
+             decl = table->typedecls.declare(ovl, t);
          else                   // just re-declare.
-            decl = typedecls.redeclare(master);
+            decl = table->typedecls.redeclare(master);
          add_member(decl);      // remember we saw a declaration.
          return decl;
       }
@@ -1249,16 +1747,16 @@ namespace ipr {
       impl::Fundecl*
       Scope::make_fundecl(const ipr::Name& n, const ipr::Function& t)
       {
-         impl::Overload* ovl = overloads.insert(n, node_compare());
+         impl::Overload* ovl = overload_set(n);
          overload_entry* master = ovl->lookup(t);
 
          if (master == 0) {
-            impl::Fundecl* decl = fundecls.declare(ovl, t);
+            impl::Fundecl* decl = table->fundecls.declare(ovl, t);
             add_member(decl);
             return decl;
          }
          else {
-            impl::Fundecl* decl = fundecls.redeclare(master);
+            impl::Fundecl* decl = table->fundecls.redeclare(master);
             add_member(decl);
             return decl;
          }
@@ -1267,17 +1765,17 @@ namespace ipr {
       impl::Named_map*
       Scope::make_primary_map(const ipr::Name& n, const ipr::Template& t)
       {
-         impl::Overload* ovl = overloads.insert(n, node_compare());
+         impl::Overload* ovl = overload_set(n);
          overload_entry* master = ovl->lookup(t);
 
          if (master == 0) {
-            impl::Named_map* decl = primary_maps.declare(ovl, t);
+            impl::Named_map* decl = table->primary_maps.declare(ovl, t);
             decl->decl_data.master_data->primary = decl;
             add_member(decl);
             return decl;
          }
          else {
-            impl::Named_map* decl = primary_maps.redeclare(master);
+            impl::Named_map* decl = table->primary_maps.redeclare(master);
             // FIXME: set the primary field.
             add_member(decl);
             return decl;
@@ -1287,17 +1785,17 @@ namespace ipr {
       impl::Named_map*
       Scope::make_secondary_map(const ipr::Name& n, const ipr::Template& t)
       {
-         impl::Overload* ovl = overloads.insert(n, node_compare());
+         impl::Overload* ovl = overload_set(n);
          overload_entry* master = ovl->lookup(t);
 
          if (master == 0) {
-            impl::Named_map* decl = secondary_maps.declare(ovl, t);
+            impl::Named_map* decl = table->secondary_maps.declare(ovl, t);
             // FXIME: record this a secondary map and set its primary.
             add_member(decl);
             return decl;
          }
          else {
-            impl::Named_map* decl = secondary_maps.redeclare(master);
+            impl::Named_map* decl = table->secondary_maps.redeclare(master);
             // FIXME: set primary info.
             add_member(decl);
             return decl;
@@ -1337,6 +1835,255 @@ namespace ipr {
          return subregions.make(this, scope.type().type());
       }
 
+      Region*
+      Region::make_subregion(Region_index& x) {
+         Region* r = make_subregion();
+         x.add(*r, this);
+         return r;
+      }
+
+      namespace {
+         // The nodes reachable from a root: its operands, and the
+         // members of the scopes of those that have some.  A walk
+         // presents each node once to its step.
+         struct Reacher {
+            std::vector<bool> seen;
+            std::vector<const ipr::Node*> stack;
+
+            Reacher() : seen(stats::all_nodes_count()) { }
+
+            void reach(const ipr::Node& n)
+            {
+               if (std::size_t(n.node_id) >= seen.size())
+                  seen.resize(n.node_id + 1);
+               if (not seen[n.node_id]) {
+                  seen[n.node_id] = true;
+                  stack.push_back(&n);
+               }
+            }
+
+            template<class S>
+            void reach_all(const S& seq)
+            {
+               for (auto& x : seq)
+                  reach(x);
+            }
+
+            template<class F>
+            void walk(const ipr::Node& root, F step)
+            {
+               reach(root);
+               while (not stack.empty()) {
+                  const ipr::Node& n = *stack.back();
+                  stack.pop_back();
+                  step(n);
+                  for_each_operand(n, [this](const ipr::Node& x) { reach(x); });
+               }
+            }
+         };
+
+         // The regions reachable from a root, with their enclosing
+         // regions.
+         struct Region_finder : Reacher {
+            std::vector<std::pair<const ipr::Region*,
+                                  const ipr::Region*>> found;
+
+            void region(const impl::Region& r)
+            {
+               found.push_back({ &r, r.parent });
+               reach_all(r.scope.members());
+            }
+
+            template<class R>
+            void homogeneous(const R& r)
+            {
+               found.push_back({ &r, &r.parent });
+            }
+
+            void step(const ipr::Node& n)
+            {
+               switch (n.category) {
+               case class_cat: {
+                  const impl::Class& c = static_cast<const impl::Class&>(n);
+                  homogeneous(c.base_subobjects);
+                  reach_all(c.bases());
+                  region(c.body);
+                  break;
+               }
+               case namespace_cat: case union_cat:
+                  region(static_cast<const impl::Region&>
+                         (static_cast<const ipr::Udt&>(n).region()));
+                  break;
+               case enum_cat: {
+                  const impl::Enum& e = static_cast<const impl::Enum&>(n);
+                  homogeneous(e.body);
+                  reach_all(e.members());
+                  break;
+               }
+               case block_cat:
+                  region(static_cast<const impl::Block&>(n).region);
+                  break;
+               case mapping_cat:
+                  homogeneous(static_cast<const impl::Mapping&>(n).parameters);
+                  break;
+               case fundecl_cat:
+                  if (auto m = static_cast<const impl::Fundecl&>(n).init)
+                     reach(*m);
+                  break;
+               case named_map_cat:
+                  if (auto m = static_cast<const impl::Named_map&>(n).init)
+                     reach(*m);
+                  break;
+               default:
+                  break;
+               }
+            }
+         };
+      }
+
+      // ------------------------
+      // -- impl::Region_index --
+      // ------------------------
+
+      const Region_index::Entry&
+      Region_index::at(const ipr::Region& r) const
+      {
+         const int i = find(r);
+         if (i < 0)
+            throw std::domain_error("Region_index: region not indexed");
+         return entries[i];
+      }
+
+      // A region takes half the room left in the interval of its
+      // enclosing region, after the intervals of its siblings, but no
+      // more than a gap.  When there is none left, the whole tree is
+      // numbered afresh.
+      void
+      Region_index::add(const ipr::Region& r, const ipr::Region* p)
+      {
+         if (has(r))
+            return;
+         int up = -1;
+         if (p != nullptr) {
+            if (not has(*p))
+               add(*p, nullptr);
+            up = find(*p);
+         }
+         const int i = int(entries.size());
+         Entry e { &r, 0, 0, 0, 0 };
+         e.jump = i;
+         if (up < 0) {
+            e.first = roots.empty() ? 0 : entries[roots.back()].last + 1;
+            e.next = e.first;
+            e.last = e.first + gap;
+            roots.push_back(i);
+         }
+         else {
+            if (entries[up].last - entries[up].next < 3)
+               renumber();
+            Entry& u = entries[up];
+            e.first = e.next = u.next + 1;
+            e.last = u.next + std::min((u.last - u.next - 1) / 2,
+                                       Number(gap));
+            u.next = e.last;
+            e.depth = u.depth + 1;
+            e.parent = up;
+            // Jump twice as far as the enclosing region when its jump
+            // and that of its jump target span the same depth.
+            const Entry& j = entries[u.jump];
+            if (u.depth - j.depth == j.depth - entries[j.jump].depth)
+               e.jump = j.jump;
+            else
+               e.jump = up;
+            if (u.last_child < 0)
+               u.child = i;
+            else
+               entries[u.last_child].sibling = i;
+            u.last_child = i;
+         }
+         entries.push_back(e);
+         slots[r] = i;
+      }
+
+      // Number the subtree of the I-th entry in preorder from C, with
+      // room after the children of each region in proportion to the
+      // size of its subtree, so that regions added to a large one
+      // seldom call for another numbering.  Returns that size.
+      int
+      Region_index::number(int i, Number& c)
+      {
+         int n = 1;
+         entries[i].first = c++;
+         for (int k = entries[i].child; k >= 0; k = entries[k].sibling)
+            n += number(k, c);
+         entries[i].next = c - 1;
+         c += gap * Number(n);
+         entries[i].last = c++;
+         return n;
+      }
+
+      void
+      Region_index::renumber()
+      {
+         Number c = 0;
+         for (int r : roots)
+            number(r, c);
+      }
+
+      void
+      Region_index::build(const ipr::Translation_unit& unit)
+      {
+         Region_finder f;
+         f.walk(unit.global_namespace(),
+                [&f](const ipr::Node& n) { f.step(n); });
+         std::unordered_map<const ipr::Region*, const ipr::Region*> up;
+         for (auto& x : f.found)
+            up.emplace(x.first, x.second);
+         // Add the enclosing regions reached before the regions they
+         // enclose.
+         std::vector<const ipr::Region*> chain;
+         for (auto& x : f.found) {
+            for (const ipr::Region* r = x.first; r != nullptr and not has(*r);
+                 r = up.count(r) != 0 ? up[r] : nullptr)
+               chain.push_back(r);
+            for (; not chain.empty(); chain.pop_back())
+               add(*chain.back(), up[chain.back()]);
+         }
+      }
+
+      int
+      Region_index::depth(const ipr::Region& r) const
+      {
+         return at(r).depth;
+      }
+
+      const ipr::Region&
+      Region_index::ancestor(const ipr::Region& r, int d) const
+      {
+         const Entry& e = at(r);
+         if (d < 0 or d > e.depth)
+            throw std::domain_error("Region_index::ancestor: no such depth");
+         const Entry* x = &e;
+         while (x->depth > d)
+            x = &entries[entries[x->jump].depth >= d ? x->jump : x->parent];
+         return *x->region;
+      }
+
+      bool
+      Region_index::contains(const ipr::Region& outer,
+                             const ipr::Region& inner) const
+      {
+         const Entry& o = at(outer);
+         const Entry& i = at(inner);
+         return o.first <= i.first and i.last <= o.last;
+      }
+
+      bool
+      Region_index::precedes(const ipr::Region& x, const ipr::Region& y) const
+      {
+         return at(x).first < at(y).first;
+      }
+
 
       // ------------------------
       // -- impl::expr_factory --
@@ -1885,6 +2632,23 @@ namespace ipr {
          return mappings.make(r, t, l);
       }
 
+      // Strings, and the names and linkages made of them, are never
+      // doomed.
+      void
+      expr_factory::sweep(node_sweep& s)
+      {
+         s.sweep(convs);
+         s.sweep(ctors);
+         s.sweep(dtors);
+         s.sweep(lits);
+         s.sweep(rnames);
+         s.sweep(scope_refs);
+         s.sweep(template_ids);
+         s.sweep(type_ids);
+         s.sweep(sizeofs);
+         s.sweep(xtypeids);
+      }
+
 
       // -- impl::Lexicon --
 
@@ -1900,8 +2664,21 @@ namespace ipr {
          builtin_map.insert(t, unary_compare());
       }
 
-      Lexicon::Lexicon()
-            : anytype(get_identifier("typename"), cxx_linkage(), anytype),
+      static ipr::Node_registry*
+      make_registry(Lexicon::Registry r)
+      {
+         if (r == Lexicon::unregistered)
+            return nullptr;
+         return new ipr::Node_registry
+            (r == Lexicon::categorized ? ipr::Node_registry::by_id_and_category
+                                       : ipr::Node_registry::by_id);
+      }
+
+      Lexicon::Lexicon() : Lexicon(unregistered) { }
+
+      Lexicon::Lexicon(Registry r)
+            : lexicon_registry(make_registry(r)),
+              anytype(get_identifier("typename"), cxx_linkage(), anytype),
               classtype(get_identifier("class"), cxx_linkage(), anytype),
               uniontype(get_identifier("union"), cxx_linkage(), anytype),
               enumtype(get_identifier("enum"), cxx_linkage(), anytype),
@@ -1961,10 +2738,164 @@ namespace ipr {
          record_builtin_type(longdoubletype);
 
          record_builtin_type(ellipsistype);
+         building.end();
       }
 
       Lexicon::~Lexicon() { }
 
+      namespace {
+         template<class T>
+         inline T&
+         thaw(const ipr::Node& n)
+         {
+            return const_cast<T&>(static_cast<const T&>(n));
+         }
+
+         // Walk the nodes reachable from a unit, freezing the scopes
+         // and sequences of those that have some.
+         struct Freezer : Reacher {
+            void region(const ipr::Region& r)
+            {
+               impl::Region& x = thaw<impl::Region>(r);
+               x.scope.freeze();
+               reach_all(x.scope.members());
+            }
+
+            void freeze(const ipr::Node& n)
+            {
+               switch (n.category) {
+               case class_cat: {
+                  impl::Class& c = thaw<impl::Class>(n);
+                  c.base_subobjects.scope.freeze();
+                  reach_all(c.bases());
+                  region(c.region());
+                  break;
+               }
+               case namespace_cat: case union_cat:
+                  region(static_cast<const ipr::Udt&>(n).region());
+                  break;
+               case enum_cat: {
+                  impl::Enum& e = thaw<impl::Enum>(n);
+                  e.body.scope.freeze();
+                  reach_all(e.members());
+                  break;
+               }
+               case block_cat: {
+                  impl::Block& b = thaw<impl::Block>(n);
+                  b.stmt_seq.freeze();
+                  b.handler_seq.freeze();
+                  region(b.region);
+                  break;
+               }
+               case expr_list_cat:
+                  thaw<impl::Expr_list>(n).seq.seq.freeze();
+                  break;
+               case fundecl_cat:
+                  if (auto m = thaw<impl::Fundecl>(n).init)
+                     reach(*m);
+                  break;
+               case named_map_cat: {
+                  impl::Named_map& x = thaw<impl::Named_map>(n);
+                  x.args.seq.seq.freeze();
+                  if (x.init != nullptr)
+                     reach(*x.init);
+                  break;
+               }
+               case mapping_cat:
+                  thaw<impl::Mapping>(n).parameters.scope.freeze();
+                  break;
+               default:
+                  break;
+               }
+            }
+
+            void run(const ipr::Node& root)
+            {
+               walk(root, [this](const ipr::Node& n) { freeze(n); });
+            }
+         };
+      }
+
+      void
+      Lexicon::freeze(const ipr::Translation_unit& unit)
+      {
+         if (not checkpoints.empty())
+            throw std::logic_error("Lexicon::freeze: open checkpoint");
+         expr_seqs.for_each([](ref_sequence<ipr::Expr>& s) { s.freeze(); });
+         type_seqs.for_each([](ref_sequence<ipr::Type>& s) { s.freeze(); });
+         Freezer().run(unit.global_namespace());
+         is_frozen = true;
+      }
+
+      int
+      Lexicon::mark()
+      {
+         if (checkpoints.empty())
+            journal.activate();
+         ipr::Node_registry::Position p { };
+         if (node_registry != nullptr)
+            p = node_registry->position();
+         checkpoints.push_back({ journal.size(), std::move(p) });
+         return int(checkpoints.size()) - 1;
+      }
+
+      void
+      Lexicon::rollback(int d)
+      {
+         if (d < 0 or std::size_t(d) >= checkpoints.size())
+            throw std::domain_error("Lexicon::rollback: no such checkpoint");
+         journal.rewind(checkpoints[d].logged);
+         if (node_registry != nullptr)
+            node_registry->rewind(checkpoints[d].recorded);
+         close_checkpoints(d);
+      }
+
+      void
+      Lexicon::commit(int d)
+      {
+         if (d < 0 or std::size_t(d) >= checkpoints.size())
+            throw std::domain_error("Lexicon::commit: no such checkpoint");
+         close_checkpoints(d);
+      }
+
+      // Close checkpoint D and the later ones.  The entries of the log
+      // are still needed as long as an earlier checkpoint is open.
+      void
+      Lexicon::close_checkpoints(int d)
+      {
+         checkpoints.resize(d);
+         if (checkpoints.empty()) {
+            journal.deactivate();
+            journal.clear();
+         }
+      }
+
+      // Sweep until no table loses a node: a type removed may be the
+      // operand of another.  Sequences are removed last, as the
+      // products and sums over them still refer to them till then.
+      void
+      Lexicon::forget(const std::vector<unit_storage::Extent>& blocks,
+                      const std::vector<unit_storage::Span>& spans)
+      {
+         if (is_frozen)
+            throw std::logic_error("Lexicon::forget: frozen");
+         if (not checkpoints.empty())
+            throw std::logic_error("Lexicon::forget: open checkpoint");
+         node_sweep s;
+         s.extents = blocks;
+         s.spans = spans;
+         do {
+            s.progress = false;
+            expr_factory::sweep(s);
+            types.sweep(s);
+         } while (s.progress);
+         s.sweep(expr_seqs);
+         s.sweep(type_seqs);
+         types.forget_derived(s.ids);
+         if (node_registry != nullptr)
+            node_registry->forget(s);
+      }
+
       const ipr::Literal&
       Lexicon::get_literal(const ipr::Type& t, const char* s) {
          return get_literal(t, get_string(s));
@@ -2150,9 +3081,8 @@ namespace ipr {
       const ipr::Function&
       Lexicon::get_function(const ipr::Product& p, const ipr::Type& t,
                             const ipr::Linkage& l) {
-         ref_sequence<ipr::Type> ex;
-         ex.push_back(&ellipsistype);
-         return get_function(p, t, get_sum(ex), l);
+         const ipr::Type* ex = &ellipsistype;
+         return get_function(p, t, get_sum(&ex, 1), l);
       }
 
       const ipr::Function&
@@ -2171,6 +3101,16 @@ namespace ipr {
             (types.make_product(*type_seqs.insert(s, unary_compare())));
       }
 
+      const ipr::Product&
+      Lexicon::get_product(const ipr::Type* const* t, int n) {
+         if (impl::Product* p = types.find_product(t, n))
+            return *p;
+         ref_sequence<ipr::Type> s;
+         for (int i = 0; i < n; ++i)
+            s.push_back(t[i]);
+         return get_product(s);
+      }
+
       const ipr::Ptr_to_member&
       Lexicon::get_ptr_to_member(const ipr::Type& s, const ipr::Type& t) {
          return *finish_type(types.make_ptr_to_member(s, t));
@@ -2198,6 +3138,16 @@ namespace ipr {
             (types.make_sum(*type_seqs.insert(s, unary_compare())));
       }
 
+      const ipr::Sum&
+      Lexicon::get_sum(const ipr::Type* const* t, int n) {
+         if (impl::Sum* p = types.find_sum(t, n))
+            return *p;
+         ref_sequence<ipr::Type> s;
+         for (int i = 0; i < n; ++i)
+            s.push_back(t[i]);
+         return get_sum(s);
+      }
+
       const ipr::Template&
       Lexicon::get_template(const ipr::Product& p, const ipr::Type& t) {
          return *finish_type(types.make_template(p, t));
@@ -2264,20 +3214,66 @@ namespace ipr {
       }
 
                                 // -- impl::Module --
-      Module::Module(impl::Lexicon& l) : lexicon{ l }, iface{l, *this }
+      Module::Module(impl::Lexicon& l)
+            : lexicon{ l }, iface{ new impl::Interface_unit{ l, *this } }
       { }
       
       const ipr::Module_name& Module::name() const { return stems; }
 
       const ipr::Interface_unit& Module::interface_unit() const {
-         return iface;
+         return *iface;
       }
 
       const ipr::Sequence<ipr::Module_unit>&
       Module::implementation_units() const { return units; }
 
       impl::Module_unit* Module::make_unit() {
-         return units.push_back(lexicon, *this);
+         owned_units.emplace_back(lexicon, *this);
+         impl::Module_unit* u = &owned_units.back();
+         units.push_back(u);
+         return u;
+      }
+
+      namespace {
+         // The blocks of a unit's storage, and the unit itself.
+         template<class T>
+         std::vector<unit_storage::Extent>
+         extents_of(const basic_unit<T>& u)
+         {
+            if (u.storage.is_active())
+               throw std::logic_error("Module: unit storage active");
+            std::vector<unit_storage::Extent> v = u.storage.extents();
+            const char* p = reinterpret_cast<const char*>(&u);
+            v.insert(std::upper_bound(v.begin(), v.end(),
+                                      unit_storage::Extent{ p, p }),
+                     { p, p + sizeof u });
+            return v;
+         }
+      }
+
+      void
+      Module::release_unit(const ipr::Module_unit& u)
+      {
+         for (int i = 0; i < units.size(); ++i)
+            if (&units.get(i) == &u) {
+               auto x = std::find_if(owned_units.begin(), owned_units.end(),
+                                     [&u](const impl::Module_unit& y) {
+                                        return &y == &u;
+                                     });
+               lexicon.forget(extents_of(*x), x->storage.spans());
+               units.erase(i);
+               owned_units.erase(x);
+               return;
+            }
+         throw std::domain_error("Module::release_unit: not a unit");
+      }
+
+      impl::Interface_unit*
+      Module::renew_interface()
+      {
+         lexicon.forget(extents_of(*iface), iface->storage.spans());
+         iface.reset(new impl::Interface_unit{ lexicon, *this });
+         return iface.get();
       }
       
    }
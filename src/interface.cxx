@@ -5,12 +5,16 @@
 // 
 
 #include "ipr/interface"
+#include <algorithm>
+#include <atomic>
 
 namespace ipr {
 
    namespace stats {
-      static int node_total_count = 0;
-      static int node_usage_counts[last_code_cat];
+      // Nodes may be created concurrently, in distinct Lexicons.
+      static std::atomic<int> node_total_count { 0 };
+      static std::atomic<int> node_usage_counts[last_code_cat];
+      static std::atomic<std::size_t> registry_total_bytes { 0 };
 
       int
       all_nodes_count()
@@ -24,13 +28,237 @@ namespace ipr {
          // FIXME: check that "c" is in bounds.
          return node_usage_counts[c];
       }
-      
+
+      std::size_t
+      registry_bytes()
+      {
+         return registry_total_bytes;
+      }
+   }
+
+   // The registry recording the nodes constructed in this thread.
+   static thread_local Node_registry* current_registry = nullptr;
+
+   Node_registry::Node_registry(Index x)
+         : lists(x & by_category ? new List[last_code_cat] : nullptr),
+           previous(nullptr), count(0), active(false),
+           by_ids((x & by_id) != 0)
+   {
+      if (lists != nullptr)
+         stats::registry_total_bytes.fetch_add
+            (last_code_cat * sizeof (List), std::memory_order_relaxed);
+   }
+
+   Node_registry::~Node_registry()
+   {
+      if (active)
+         deactivate();
+      stats::registry_total_bytes.fetch_sub(memory(),
+                                            std::memory_order_relaxed);
+   }
+
+   std::size_t
+   Node_registry::memory() const
+   {
+      std::size_t n = chunks.capacity() * sizeof chunks[0];
+      for (auto& c : chunks)
+         if (c != nullptr)
+            n += chunk_size * sizeof c[0];
+      if (lists != nullptr)
+         for (int i = 0; i < last_code_cat; ++i)
+            n += sizeof (List)
+               + lists[i].chunks.capacity() * sizeof lists[i].chunks[0]
+               + lists[i].chunks.size() * List::chunk_size * sizeof (Node*);
+      return n;
+   }
+
+   Node_registry::Range
+   Node_registry::nodes(Category_code c) const
+   {
+      if (lists == nullptr)
+         return { nullptr, 0, 0 };
+      return { &lists[c], 0, lists[c].count };
+   }
+
+   Node_registry::Position
+   Node_registry::position() const
+   {
+      Position p { count, stats::all_nodes_count(), { } };
+      if (lists != nullptr)
+         for (int i = 0; i < last_code_cat; ++i)
+            p.listed.push_back(lists[i].count);
+      return p;
+   }
+
+   // The nodes recorded in this thread since P have node_ids no less
+   // than P.first_id; those of other threads are not recorded here.
+   void
+   Node_registry::rewind(const Position& p)
+   {
+      count = p.count;
+      if (lists != nullptr)
+         for (std::size_t i = 0; i < p.listed.size(); ++i)
+            lists[i].count = p.listed[i];
+      // Clear the first chunk from P.first_id on, and free the chunks
+      // that are left empty.
+      const std::size_t first = std::size_t(p.first_id) >> chunk_bits;
+      const std::size_t offset = p.first_id & (chunk_size - 1);
+      for (std::size_t c = first; c < chunks.size(); ++c) {
+         if (chunks[c] == nullptr)
+            continue;
+         if (c == first) {
+            std::fill(&chunks[c][offset], &chunks[c][chunk_size], nullptr);
+            const Node* const* start = &chunks[c][0];
+            if (std::any_of(start, start + offset,
+                            [](const Node* n) { return n != nullptr; }))
+               continue;
+         }
+         chunks[c].reset();
+         stats::registry_total_bytes.fetch_sub
+            (chunk_size * sizeof (const Node*), std::memory_order_relaxed);
+      }
+   }
+
+   void
+   Node_registry::forget(const Filter& doomed)
+   {
+      int forgotten = 0;
+      if (lists != nullptr)
+         for (int i = 0; i < last_code_cat; ++i) {
+            List& l = lists[i];
+            int n = 0;
+            for (int j = 0; j < l.count; ++j) {
+               const Node* x = &l.at(j);
+               if (not doomed(*x)) {
+                  l.chunks[n >> List::chunk_bits][n & (List::chunk_size - 1)]
+                     = x;
+                  ++n;
+               }
+            }
+            forgotten += l.count - n;
+            l.count = n;
+         }
+      if (by_ids)
+         forgotten = 0;
+      for (auto& c : chunks) {
+         if (c == nullptr)
+            continue;
+         bool empty = true;
+         for (int i = 0; i < chunk_size; ++i)
+            if (c[i] != nullptr) {
+               if (doomed(*c[i])) {
+                  c[i] = nullptr;
+                  ++forgotten;
+               }
+               else
+                  empty = false;
+            }
+         if (empty) {
+            c.reset();
+            stats::registry_total_bytes.fetch_sub
+               (chunk_size * sizeof (const Node*), std::memory_order_relaxed);
+         }
+      }
+      count -= forgotten;
+   }
+
+   void
+   Node_registry::activate()
+   {
+      if (active)
+         throw std::logic_error("Node_registry already active");
+      previous = current_registry;
+      current_registry = this;
+      active = true;
+   }
+
+   void
+   Node_registry::deactivate()
+   {
+      for (Node_registry** p = &current_registry; *p != nullptr;
+           p = &(*p)->previous)
+         if (*p == this) {
+            *p = previous;
+            break;
+         }
+      previous = nullptr;
+      active = false;
+   }
+
+   void
+   Node_registry::record(const Node& n)
+   {
+      ++count;
+      if (lists != nullptr) {
+         List& l = lists[n.category];
+         const std::size_t c = std::size_t(l.count) >> List::chunk_bits;
+         if (c == l.chunks.size()) {
+            const std::size_t before = l.chunks.capacity();
+            l.chunks.emplace_back(new const Node*[List::chunk_size]);
+            stats::registry_total_bytes.fetch_add
+               ((l.chunks.capacity() - before) * sizeof l.chunks[0]
+                + List::chunk_size * sizeof (Node*),
+                std::memory_order_relaxed);
+         }
+         l.chunks[c][l.count++ & (List::chunk_size - 1)] = &n;
+      }
+      if (not by_ids)
+         return;
+      const std::size_t c = std::size_t(n.node_id) >> chunk_bits;
+      if (c >= chunks.size()) {
+         const std::size_t before = chunks.capacity();
+         chunks.resize(c + 1);
+         stats::registry_total_bytes.fetch_add
+            ((chunks.capacity() - before) * sizeof chunks[0],
+             std::memory_order_relaxed);
+      }
+      if (chunks[c] == nullptr) {
+         chunks[c].reset(new const Node*[chunk_size]());
+         stats::registry_total_bytes.fetch_add
+            (chunk_size * sizeof (const Node*), std::memory_order_relaxed);
+      }
+      chunks[c][n.node_id & (chunk_size - 1)] = &n;
+   }
+
+   Node_registry*
+   Node_registry::current()
+   {
+      return current_registry;
+   }
+
+   Node_registry::Recording::Recording(Node_registry* r)
+         : saved(current_registry), ended(false)
+   {
+      current_registry = r;
+   }
+
+   void
+   Node_registry::Recording::end()
+   {
+      if (not ended) {
+         current_registry = saved;
+         ended = true;
+      }
+   }
+
+   Node_registry::Pause::Pause() : saved(current_registry)
+   {
+      current_registry = nullptr;
+   }
+
+   Node_registry::Pause::~Pause()
+   {
+      current_registry = saved;
    }
 
    Node::Node(Category_code c)
-         : node_id(stats::node_total_count++), category(c)
+         : node_id(stats::node_total_count.fetch_add
+                   (1, std::memory_order_relaxed)),
+           category(c)
    {
       // FIXME: Implement checking of "c".
-      ++stats::node_usage_counts[c];
+      stats::node_usage_counts[c].fetch_add(1, std::memory_order_relaxed);
+      if (current_registry != nullptr)
+         current_registry->record(*this);
    }
 };
@@ -6,9 +6,12 @@
 
 #include <assert.h>
 #include <ipr/io>
+#include <ipr/property>
 #include <ipr/traversal>
 #include <ostream>
+#include <sstream>
 #include <cctype>
+#include <cstring>
 #include <typeinfo>
 #include <stdexcept>
 #include <iostream>
@@ -26,23 +29,121 @@ namespace ipr
       Printer& pp;
    };
    
-   Printer::Printer(std::ostream& os)
-         : stream(os), pad(None), emit_newline(false),
-           pending_indentation(0) { }
+   // Types are maximally shared, so that the same type node is printed
+   // once for each signature that mentions it.  Its text is kept the
+   // first time, along with the padding it leaves, and merely copied
+   // out afterwards.  The text depends on whether it is printed after
+   // an identifier, and on the formatting flags of the stream; it is
+   // not kept at all when it spans lines, since it then depends on the
+   // indentation of the place where it appears.  In compact output,
+   // the spaces pending at either end of the text are kept aside, to be
+   // settled against the text around each copy.  A printer makes its
+   // cache when it first prints a type, so that those that print only
+   // names or literals pay nothing for it.
+   struct Printer::Type_cache {
+      enum { limit = 1 << 22 };         // bytes of text kept at most
+
+      struct Text {
+         enum State { Unknown, Kept, Spoiled };
+         State state = Unknown;
+         Padding padding = None;
+         bool leading = false;
+         bool trailing = false;
+         std::string chars;
+      };
+
+      struct Entry {
+         Text after[2];                 // indexed by padding() == Before
+      };
+
+      Sparse_node_map<Entry> entries;
+      std::size_t bytes = 0;
+      std::ios_base::fmtflags flags;
+   };
+
+   Printer::Printer(std::ostream& os, Layout l)
+         : stream(os), form(l), pad(None), emit_newline(false),
+           pending_indentation(0), spacing(false), leading(false),
+           last('\0')
+   { }
+
+   Printer::~Printer() = default;
    
    Printer&
    Printer::operator<<(const char* s)
    {
-      this->stream << s;
+      if (*s != '\0') {
+         put(*s);
+         this->stream << s;
+         last = s[std::strlen(s) - 1];
+      }
       return *this;
    }
 
    void
    Printer::write(const char* begin, const char* last)
    {
-      std::copy(begin, last, std::ostream_iterator<char>(this->stream));
+      if (begin == last)
+         return;
+      put(*begin);
+      this->stream.write(begin, last - begin);
+      this->last = last[-1];
    }
-   
+
+   void
+   Printer::space()
+   {
+      if (form == Compact)
+         spacing = true;
+      else
+         *this << ' ';
+   }
+
+   // Tokens run together when both are made of word characters, or
+   // both of operator characters; a number also takes in a sign that
+   // follows an exponent.  Brackets, separators and spaces stand apart.
+   namespace {
+      enum Lexical_class : unsigned char { Apart, Word_char, Operator_char };
+
+      struct Lexical_classes {
+         Lexical_class of[256];
+      };
+
+      constexpr Lexical_classes
+      lexical_classes()
+      {
+         Lexical_classes t { };
+         for (int c = 0; c < 256; ++c)
+            if ((c >= 'a' and c <= 'z') or (c >= 'A' and c <= 'Z')
+                or (c >= '0' and c <= '9') or c == '_' or c == '#'
+                or c == '$' or c == '\'' or c == '"' or c >= 0x80)
+               t.of[c] = Word_char;
+            else if (c > ' ' and c < 0x7F and c != '(' and c != ')'
+                     and c != '[' and c != ']' and c != '{' and c != '}'
+                     and c != ',' and c != ';')
+               t.of[c] = Operator_char;
+         return t;
+      }
+
+      constexpr Lexical_classes lexical = lexical_classes();
+   }
+
+   void
+   Printer::separate(char c)
+   {
+      spacing = false;
+      if (last == '\0') {
+         leading = true;
+         return;
+      }
+      const Lexical_class x = lexical.of[static_cast<unsigned char>(last)];
+      const Lexical_class y = lexical.of[static_cast<unsigned char>(c)];
+      if ((x != Apart and x == y)
+          or (y == Operator_char and (c == '+' or c == '-')
+              and (last == 'e' or last == 'E' or last == 'p' or last == 'P')))
+         stream << ' ';
+   }
+
    template<typename T>
    struct Token_helper {
       T const value;
@@ -62,6 +163,37 @@ namespace ipr
    {
       return printer << t.value << Printer::None;
    }
+
+   // In compact output, spaces around tokens are left to space().
+   inline Printer&
+   operator<<(Printer& printer, Token_helper<char> t)
+   {
+      if (t.value == ' ' and printer.layout() == Printer::Compact)
+         printer.space();
+      else
+         printer << t.value;
+      return printer << Printer::None;
+   }
+
+   inline Printer&
+   operator<<(Printer& printer, Token_helper<const char*> t)
+   {
+      if (printer.layout() == Printer::Pretty)
+         return printer << t.value << Printer::None;
+      const char* first = t.value;
+      const char* last = first + std::strlen(first);
+      if (first != last and *first == ' ') {
+         printer.space();
+         ++first;
+      }
+      const bool trailing = first != last and last[-1] == ' ';
+      if (trailing)
+         --last;
+      printer.write(first, last);
+      if (trailing)
+         printer.space();
+      return printer << Printer::None;
+   }
    
    inline Printer&
    insert_xtoken(Printer& printer, const char* s)
@@ -83,6 +215,11 @@ namespace ipr
    Printer&
    operator<<(Printer& printer, newline)
    {
+      if (printer.layout() == Printer::Compact) {
+         printer.space();
+         printer.needs_newline(false);
+         return printer << Printer::None;
+      }
       printer << token('\n');
       const int n = printer.indent();
       for (int i = 0; i < n; ++i)
@@ -208,7 +345,7 @@ namespace ipr
    operator<<(Printer& printer, xpr_identifier id)
    {
       if (printer.padding() == Printer::Before)
-         printer << ' ';
+         printer.space();
       printer.write(id.begin, id.last);
       
       return printer <<  Printer::Before;
@@ -1452,11 +1589,94 @@ namespace ipr
    };
    // <<<< Yuriy Solodkyy: 2006/05/31    
 
+   static Printer&
+   print_type(Printer& printer, const Type& t)
+   {
+      xpr_type_visitor impl(printer);
+      t.accept(impl);
+      return printer;
+   }
+
+   // Send the output of a stream to a buffer, for the time of a scope.
+   struct stream_diversion {
+      stream_diversion(std::ostream& s, std::streambuf& b)
+            : os(s), state(s.rdstate()), sink(s.rdbuf(&b)) { }
+      ~stream_diversion() { os.rdbuf(sink); os.clear(state); }
+
+   private:
+      std::ostream& os;
+      const std::ios_base::iostate state;
+      std::streambuf* const sink;
+   };
+
    Printer&
    operator<<(Printer& printer, xpr_type x)
    {
-      xpr_type_visitor impl(printer);
-      x.type.accept(impl);
+      std::ostream& os = printer.stream;
+      const std::ios_base::fmtflags flags = os.flags();
+      if (printer.types == nullptr) {
+         printer.types.reset(new Printer::Type_cache);
+         printer.types->flags = flags;
+      }
+      Printer::Type_cache& cache = *printer.types;
+      if (flags != cache.flags) {
+         cache.entries.clear();
+         cache.bytes = 0;
+         cache.flags = flags;
+      }
+
+      using Text = Printer::Type_cache::Text;
+      const int after = printer.pad == Printer::Before;
+      auto copy = [&printer](const Text& t) {
+         printer.spacing = printer.spacing or t.leading;
+         printer.write(t.chars.data(), t.chars.data() + t.chars.size());
+         printer.spacing = printer.spacing or t.trailing;
+         printer.pad = t.padding;
+      };
+      const Printer::Type_cache::Entry* e = cache.entries.find(x.type);
+      if (e != nullptr and e->after[after].state == Text::Kept) {
+         copy(e->after[after]);
+         return printer;
+      }
+      if (e != nullptr and e->after[after].state == Text::Spoiled)
+         return print_type(printer, x.type);
+      if (e == nullptr and cache.bytes >= Printer::Type_cache::limit)
+         return print_type(printer, x.type);
+
+      std::stringbuf buffer;
+      const bool newline = printer.emit_newline;
+      const int indentation = printer.pending_indentation;
+      Text text;
+      {
+         const bool spacing = printer.spacing;
+         const char last = printer.last;
+         printer.spacing = printer.leading = false;
+         printer.last = '\0';
+         {
+            stream_diversion diversion { os, buffer };
+            print_type(printer, x.type);
+         }
+         text.leading = printer.leading;
+         text.trailing = printer.spacing;
+         text.padding = printer.pad;
+         text.chars = buffer.str();
+         printer.spacing = spacing;
+         printer.last = last;
+      }
+      copy(text);
+
+      // Entries may have moved, or been cleared, while printing X.
+      Text& t = cache.entries[x.type].after[after];
+      if (text.chars.find('\n') != std::string::npos
+          or printer.emit_newline != newline
+          or printer.pending_indentation != indentation
+          or os.flags() != flags)
+         t.state = Text::Spoiled;
+      else {
+         cache.bytes += text.chars.size();
+         t = std::move(text);
+         t.state = Text::Kept;
+      }
       return printer;
    }
 
@@ -1799,7 +2019,7 @@ namespace ipr
          {
             pp << ipr::xpr_name(f)
                << token(" : ")
-               << f.specifiers() << ' '
+               << f.specifiers() << token(' ')
                << token('(') << f.parameters() << token(')');
 
             const Function* pfn = util::view<Function>(f.type());
@@ -0,0 +1,274 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/locations>
+#include <ipr/traversal>
+#include <algorithm>
+#include <cmath>
+
+namespace ipr {
+   namespace {
+      using Key = std::uint64_t;
+
+      inline Key
+      key(Basic_location x)
+      {
+         return Key(x.line) << 32 | Key(x.column);
+      }
+
+      inline Basic_location
+      location(Key k)
+      {
+         Basic_location x;
+         x.line = Line_number(k >> 32);
+         x.column = Column_number(k & 0xFFFFFFFF);
+         return x;
+      }
+
+      // Of extents that contain a position, the innermost sorts last.
+      template<class E>
+      inline bool
+      inner(const E& x, const E& y)
+      {
+         return x.first > y.first or (x.first == y.first and x.last <= y.last);
+      }
+
+      // Record, at the middle of each range of extents, the furthest
+      // last position of that range; returns it.
+      template<class E>
+      Key
+      build_reach(const std::vector<E>& v, std::vector<Key>& reach,
+                  std::size_t lo, std::size_t hi)
+      {
+         if (lo >= hi)
+            return 0;
+         const std::size_t mid = lo + (hi - lo) / 2;
+         const Key k = std::max({ v[mid].last,
+                                  build_reach(v, reach, lo, mid),
+                                  build_reach(v, reach, mid + 1, hi) });
+         reach[mid] = k;
+         return k;
+      }
+
+      // Present, in order, the extents of [lo, hi) that meet [first, last].
+      template<class E, class F>
+      void
+      meet(const std::vector<E>& v, const std::vector<Key>& reach,
+           std::size_t lo, std::size_t hi, Key first, Key last, F f)
+      {
+         while (lo < hi) {
+            const std::size_t mid = lo + (hi - lo) / 2;
+            if (reach[mid] < first)
+               return;
+            meet(v, reach, lo, mid, first, last, f);
+            if (v[mid].first > last)
+               return;
+            if (v[mid].last >= first)
+               f(v[mid]);
+            lo = mid + 1;
+         }
+      }
+   }
+
+   // The extent of [lo, hi) that contains K and sorts last, if any;
+   // extents from END on start after K.  Since extents are sorted outer
+   // ones first, that is the innermost.  The furthest last position of
+   // a subtree rules it out only when all of it starts before K, which
+   // leaves one subtree per level to descend into.
+   const Location_index::Extent*
+   Location_index::innermost(const Table& t, std::size_t lo, std::size_t hi,
+                             std::size_t end, Key k) const
+   {
+      if (lo >= hi or lo >= end)
+         return nullptr;
+      const std::size_t mid = lo + (hi - lo) / 2;
+      if (hi <= end and t.reach[mid] < k)
+         return nullptr;
+      if (mid < end) {
+         if (const Extent* y = innermost(t, mid + 1, hi, end, k))
+            return y;
+         const Extent& x = t.sorted[mid];
+         if (k <= x.last and live(x))
+            return &x;
+      }
+      return innermost(t, lo, mid, end, k);
+   }
+
+   // Extents are sorted by first position, outer ones first; those
+   // that are equal stay in the order they were added, which for a
+   // traversal is the order of nesting.
+   void
+   Location_index::rebuild(Table& t)
+   {
+      auto stale = [this](const Extent& x) { return not live(x); };
+      auto order = [](const Extent& x, const Extent& y) {
+         return x.first < y.first or (x.first == y.first and x.last > y.last);
+      };
+      t.sorted.erase(std::remove_if(t.sorted.begin(), t.sorted.end(), stale),
+                     t.sorted.end());
+      t.recent.erase(std::remove_if(t.recent.begin(), t.recent.end(), stale),
+                     t.recent.end());
+      std::stable_sort(t.recent.begin(), t.recent.end(), order);
+      const std::size_t n = t.sorted.size();
+      t.sorted.insert(t.sorted.end(), t.recent.begin(), t.recent.end());
+      std::inplace_merge(t.sorted.begin(), t.sorted.begin() + n,
+                         t.sorted.end(), order);
+      t.recent.clear();
+      t.stale = 0;
+      t.reach.resize(t.sorted.size());
+      build_reach(t.sorted, t.reach, 0, t.sorted.size());
+   }
+
+   void
+   Location_index::insert(const ipr::Stmt& s, Basic_location last)
+   {
+      erase(s);
+      const Source_location& loc = s.source_location();
+      Table& t = tables[loc.file];
+      t.recent.push_back({ key(loc), std::max(key(loc), key(last)), &s,
+                           ++serial });
+      where[s] = { std::uint32_t(loc.file) + 1, serial };
+      ++count;
+      // Queries scan the recent extents, and a rebuild takes time linear
+      // in the number of extents: balance both.
+      if (t.recent.size() > 32 + std::sqrt(double(t.sorted.size())))
+         rebuild(t);
+   }
+
+   bool
+   Location_index::erase(const ipr::Stmt& s)
+   {
+      const Place p = where(s);
+      if (p.file == 0)
+         return false;
+      where[s] = { };
+      --count;
+      Table& t = tables[File_index(p.file - 1)];
+      if (++t.stale > 32 + t.sorted.size() / 4)
+         rebuild(t);
+      return true;
+   }
+
+   const ipr::Stmt*
+   Location_index::at(File_index f, Basic_location p) const
+   {
+      auto t = tables.find(f);
+      if (t == tables.end())
+         return nullptr;
+      const Table& table = t->second;
+      const Key k = key(p);
+      const std::size_t end =
+         std::partition_point(table.sorted.begin(), table.sorted.end(),
+                              [k](const Extent& x) { return x.first <= k; })
+         - table.sorted.begin();
+      const Extent* best = innermost(table, 0, table.sorted.size(), end, k);
+      for (auto& x : table.recent)
+         if (x.first <= k and k <= x.last and live(x)
+             and (best == nullptr or inner(x, *best)))
+            best = &x;
+      return best == nullptr ? nullptr : best->stmt;
+   }
+
+   std::vector<Location_index::Entry>
+   Location_index::in(File_index f, Basic_location first,
+                      Basic_location last) const
+   {
+      std::vector<Entry> result;
+      auto t = tables.find(f);
+      if (t == tables.end())
+         return result;
+      const Table& table = t->second;
+      const Key a = key(first);
+      const Key b = key(last);
+      auto keep = [&](const Extent& x) {
+         if (live(x))
+            result.push_back({ x.stmt, location(x.first), location(x.last) });
+      };
+      meet(table.sorted, table.reach, 0, table.sorted.size(), a, b, keep);
+      const std::size_t n = result.size();
+      for (auto& x : table.recent)
+         if (x.first <= b and a <= x.last)
+            keep(x);
+      std::stable_sort(result.begin() + n, result.end(),
+                       [](const Entry& x, const Entry& y) {
+                          return key(x.first) < key(y.first);
+                       });
+      std::inplace_merge(result.begin(), result.begin() + n, result.end(),
+                         [](const Entry& x, const Entry& y) {
+                            return key(x.first) < key(y.first);
+                         });
+      return result;
+   }
+
+   // The traversal enters each node once.  A statement is given its
+   // place among the extents of its file when it is entered, so that
+   // nested statements follow it, and its last position when it is
+   // left: the furthest of its own location and of the last positions
+   // of the statements directly within it, in the same file.
+   Location_index::Location_index(const ipr::Translation_unit& unit)
+   {
+      struct Frame {
+         const ipr::Node* node;
+         bool entered;
+      };
+      struct Open {
+         const ipr::Stmt* stmt;
+         File_index file;
+         Key last;
+         std::size_t place;             // in the extents of its file
+      };
+
+      std::map<File_index, std::vector<Extent>> extents;
+      std::vector<Frame> stack;
+      std::vector<Open> open;
+      Node_set seen;
+      auto reach = [&](const ipr::Node& n) {
+         if (seen.insert(n))
+            stack.push_back({ &n, false });
+      };
+
+      reach(unit.global_namespace());
+      while (not stack.empty()) {
+         Frame& top = stack.back();
+         const ipr::Node& n = *top.node;
+         if (top.entered) {
+            stack.pop_back();
+            if (open.empty() or open.back().stmt != &n)
+               continue;
+            const Open x = open.back();
+            open.pop_back();
+            extents[x.file][x.place].last = x.last;
+            if (not open.empty() and open.back().file == x.file)
+               open.back().last = std::max(open.back().last, x.last);
+            continue;
+         }
+
+         top.entered = true;
+         if (n.category > stmt_cat) {
+            const ipr::Stmt& s = static_cast<const ipr::Stmt&>(n);
+            const Source_location& loc = s.source_location();
+            if (loc.line != Line_number{ }) {
+               std::vector<Extent>& v = extents[loc.file];
+               open.push_back({ &s, loc.file, key(loc), v.size() });
+               v.push_back({ key(loc), key(loc), &s, ++serial });
+            }
+         }
+         // Push operands in reverse, so that they are entered in order.
+         const std::size_t mark = stack.size();
+         for_each_part(n, reach);
+         std::reverse(stack.begin() + mark, stack.end());
+      }
+
+      for (auto& e : extents) {
+         Table& t = tables[e.first];
+         t.recent = std::move(e.second);
+         for (auto& x : t.recent)
+            where[*x.stmt] = { std::uint32_t(e.first) + 1, x.serial };
+         count += t.recent.size();
+         rebuild(t);
+      }
+   }
+}
@@ -0,0 +1,299 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/match>
+#include <ipr/traversal>
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <stdexcept>
+
+namespace ipr {
+   namespace match {
+      struct Pattern::Rep {
+         enum Kind {
+            any, category, name, resolution, operand, type,
+            conjunction, disjunction, negation
+         };
+
+         Kind kind;
+         Category_code cat = Category_code();
+         int rank = 0;
+         std::string text;
+         std::shared_ptr<const Rep> left;
+         std::shared_ptr<const Rep> right;
+
+         explicit Rep(Kind k) : kind(k) { }
+      };
+
+      struct Engine::Entry {
+         Pattern pattern;
+         Callback callback;
+      };
+
+      namespace {
+         using Rep = Pattern::Rep;
+         using Category_set = std::bitset<last_code_cat>;
+
+         Pattern
+         make(Rep::Kind k, std::shared_ptr<const Rep> l = nullptr,
+              std::shared_ptr<const Rep> r = nullptr)
+         {
+            auto p = std::make_shared<Rep>(k);
+            p->left = std::move(l);
+            p->right = std::move(r);
+            return Pattern(std::move(p));
+         }
+
+         // The categories of the nodes that a pattern may match.
+         Category_set
+         roots(const Rep& p)
+         {
+            switch (p.kind) {
+            case Rep::category: {
+               Category_set s;
+               s.set(p.cat);
+               return s;
+            }
+            case Rep::resolution: {
+               Category_set s;
+               s.set(id_expr_cat);
+               return s;
+            }
+            case Rep::conjunction:
+               return roots(*p.left) & roots(*p.right);
+            case Rep::disjunction:
+               return roots(*p.left) | roots(*p.right);
+            default:
+               return Category_set().set();
+            }
+         }
+
+         bool
+         spelled(const ipr::Name& n, const std::string& s)
+         {
+            if (n.category != identifier_cat)
+               return false;
+            const ipr::String& x = static_cast<const Identifier&>(n).string();
+            return std::size_t(x.size()) == s.size()
+               and std::equal(x.begin(), x.end(), s.begin());
+         }
+
+         // The operand of a node with the given rank, or null.
+         const ipr::Node*
+         operand_of(const ipr::Node& n, int rank)
+         {
+            const ipr::Node* result = nullptr;
+            int i = 0;
+            for_each_operand(n, [&](const ipr::Node& x) {
+                  if (i++ == rank)
+                     result = &x;
+               });
+            return result;
+         }
+
+         bool
+         eval(const Rep& p, const ipr::Node& n)
+         {
+            switch (p.kind) {
+            case Rep::any:
+               return true;
+            case Rep::category:
+               return n.category == p.cat;
+            case Rep::name:
+               if (n.category == identifier_cat)
+                  return spelled(static_cast<const ipr::Name&>(n), p.text);
+               if (n.category == id_expr_cat)
+                  return spelled(static_cast<const Id_expr&>(n).name(), p.text);
+               if (is_decl(n.category))
+                  return spelled(static_cast<const Decl&>(n).name(), p.text);
+               return false;
+            case Rep::resolution:
+               if (n.category != id_expr_cat)
+                  return false;
+               try {
+                  return eval(*p.left,
+                              static_cast<const Id_expr&>(n).resolution());
+               }
+               catch (const std::logic_error&) {
+                  return false;         // unresolved
+               }
+            case Rep::operand: {
+               const ipr::Node* x = operand_of(n, p.rank);
+               return x != nullptr and eval(*p.left, *x);
+            }
+            case Rep::type:
+               if (n.category <= expr_cat)
+                  return false;
+               try {
+                  return eval(*p.left, static_cast<const Expr&>(n).type());
+               }
+               catch (const std::logic_error&) {
+                  return false;         // untyped
+               }
+            case Rep::conjunction:
+               return eval(*p.left, n) and eval(*p.right, n);
+            case Rep::disjunction:
+               return eval(*p.left, n) or eval(*p.right, n);
+            case Rep::negation:
+               return not eval(*p.left, n);
+            }
+            return false;
+         }
+      }
+
+      Pattern
+      any()
+      {
+         return make(Rep::any);
+      }
+
+      Pattern
+      of(Category_code c)
+      {
+         if (c < 0 or c >= last_code_cat)
+            throw std::domain_error("match::of: invalid category");
+         Pattern p = make(Rep::category);
+         const_cast<Rep&>(*p.rep).cat = c;
+         return p;
+      }
+
+      Pattern
+      named(const std::string& s)
+      {
+         Pattern p = make(Rep::name);
+         const_cast<Rep&>(*p.rep).text = s;
+         return p;
+      }
+
+      Pattern
+      resolves(const Pattern& d)
+      {
+         return make(Rep::resolution, d.rep);
+      }
+
+      Pattern
+      operand(int i, const Pattern& x)
+      {
+         if (i < 0)
+            throw std::domain_error("match::operand: negative rank");
+         Pattern p = make(Rep::operand, x.rep);
+         const_cast<Rep&>(*p.rep).rank = i;
+         return p;
+      }
+
+      Pattern
+      typed(const Pattern& t)
+      {
+         return make(Rep::type, t.rep);
+      }
+
+      Pattern
+      operator and(const Pattern& a, const Pattern& b)
+      {
+         return make(Rep::conjunction, a.rep, b.rep);
+      }
+
+      Pattern
+      operator or(const Pattern& a, const Pattern& b)
+      {
+         return make(Rep::disjunction, a.rep, b.rep);
+      }
+
+      Pattern
+      operator not(const Pattern& a)
+      {
+         return make(Rep::negation, a.rep);
+      }
+
+      // -- Engine --
+
+      Engine::Engine(const Options& opts)
+            : options(opts), compiled(false)
+      { }
+
+      Engine::~Engine() { }
+
+      int
+      Engine::add(const std::string& name, const Pattern& p, Callback f)
+      {
+         entries.push_back({ p, std::move(f) });
+         stats.emplace_back();
+         stats.back().name = name;
+         compiled = false;
+         return int(entries.size()) - 1;
+      }
+
+      void
+      Engine::compile()
+      {
+         table.assign(last_code_cat, { });
+         for (std::size_t i = 0; i < entries.size(); ++i) {
+            const Category_set s = roots(*entries[i].pattern.rep);
+            for (int c = 0; c < last_code_cat; ++c)
+               if (s.test(c))
+                  table[c].push_back(int(i));
+         }
+         compiled = true;
+      }
+
+      void
+      Engine::test(const ipr::Node& n)
+      {
+         using clock = std::chrono::steady_clock;
+         for (int i : table[n.category]) {
+            Counter& k = stats[i];
+            ++k.tests;
+            bool hit;
+            if (options.timing) {
+               const auto start = clock::now();
+               hit = eval(*entries[i].pattern.rep, n);
+               k.seconds += std::chrono::duration<double>
+                  (clock::now() - start).count();
+            }
+            else
+               hit = eval(*entries[i].pattern.rep, n);
+            if (hit) {
+               ++k.hits;
+               if (entries[i].callback)
+                  entries[i].callback(n);
+            }
+         }
+      }
+
+      void
+      Engine::run(const ipr::Translation_unit& unit)
+      {
+         run(unit.global_namespace());
+      }
+
+      void
+      Engine::run(const ipr::Node& root)
+      {
+         if (not compiled)
+            compile();
+
+         std::vector<bool> seen(ipr::stats::all_nodes_count());
+         std::vector<const ipr::Node*> stack;
+         auto reach = [&](const ipr::Node& n) {
+            if (std::size_t(n.node_id) >= seen.size())
+               seen.resize(n.node_id + 1);
+            if (not seen[n.node_id]) {
+               seen[n.node_id] = true;
+               stack.push_back(&n);
+            }
+         };
+
+         reach(root);
+         while (not stack.empty()) {
+            const ipr::Node& n = *stack.back();
+            stack.pop_back();
+            test(n);
+            for_each_part(n, reach);
+         }
+      }
+   }
+}
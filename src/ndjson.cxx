@@ -0,0 +1,193 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/ndjson>
+#include <ipr/traversal>
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+
+namespace ipr {
+   namespace ndjson {
+      Writer::Writer(std::ostream& os, std::size_t n)
+            : os(os), buf(n < 64 ? 64 : n), cur()
+      { }
+
+      void
+      Writer::flush()
+      {
+         os.write(buf.data(), cur);
+         cur = 0;
+      }
+
+      void
+      Writer::put(const char* s)
+      {
+         while (*s != 0)
+            put(*s++);
+      }
+
+      void
+      Writer::put(long long n)
+      {
+         char digits[24];
+         int i = sizeof digits;
+         unsigned long long v = n < 0 ? -static_cast<unsigned long long>(n) : n;
+         do
+            digits[--i] = '0' + v % 10;
+         while ((v /= 10) != 0);
+         if (n < 0)
+            digits[--i] = '-';
+         if (buf.size() - cur < sizeof digits)
+            flush();
+         std::memcpy(&buf[cur], digits + i, sizeof digits - i);
+         cur += sizeof digits - i;
+      }
+
+      void
+      Writer::put_string(const char* first, const char* last)
+      {
+         static const char hex[] = "0123456789abcdef";
+         put('"');
+         for (; first != last; ++first) {
+            unsigned char c = *first;
+            switch (c) {
+            case '"':  put("\\\""); break;
+            case '\\': put("\\\\"); break;
+            case '\n': put("\\n"); break;
+            case '\r': put("\\r"); break;
+            case '\t': put("\\t"); break;
+            default:
+               if (c < 0x20) {
+                  put("\\u00");
+                  put(hex[c >> 4]);
+                  put(hex[c & 0xF]);
+               }
+               else
+                  put(char(c));
+            }
+         }
+         put('"');
+      }
+
+      namespace {
+         struct Exporter {
+            Writer out;
+            const Options& options;
+            std::vector<bool> seen;
+            std::vector<const ipr::Node*> stack;
+            std::size_t count = 0;
+
+            Exporter(std::ostream& os, const Options& opts)
+                  : out(os, opts.buffer_size), options(opts),
+                    seen(stats::all_nodes_count())
+            { }
+
+            // Schedule a node, unless it was already.
+            void reach(const ipr::Node& n)
+            {
+               if (std::size_t(n.node_id) >= seen.size())
+                  seen.resize(n.node_id + 1);
+               if (not seen[n.node_id]) {
+                  seen[n.node_id] = true;
+                  stack.push_back(&n);
+               }
+            }
+
+            template<class S>
+            void list(const char* field, const S& seq)
+            {
+               out.put(field);
+               char sep = '[';
+               for (auto& x : seq) {
+                  out.put(sep);
+                  out.put(static_cast<long long>(x.node_id));
+                  sep = ',';
+               }
+               if (sep == '[')
+                  out.put('[');
+               out.put(']');
+            }
+
+            void record(const ipr::Node& n)
+            {
+               out.put("{\"id\":");
+               out.put(static_cast<long long>(n.node_id));
+               out.put(",\"cat\":");
+               out.put(static_cast<long long>(n.category));
+
+               if (n.category == string_cat) {
+                  const String& s = static_cast<const String&>(n);
+                  out.put(",\"text\":");
+                  out.put_string(s.begin(), s.end());
+               }
+
+               out.put(",\"ops\":");
+               char sep = '[';
+               for_each_operand(n, [&](const Node& x) {
+                     out.put(sep);
+                     out.put(static_cast<long long>(x.node_id));
+                     sep = ',';
+                  });
+               if (sep == '[')
+                  out.put('[');
+               out.put(']');
+
+               if (is_decl(n.category)) {
+                  out.put(",\"spec\":");
+                  out.put(static_cast<long long>
+                          (static_cast<const Decl&>(n).specifiers()));
+               }
+               if (n.category > stmt_cat) {
+                  const Source_location& loc =
+                     static_cast<const Stmt&>(n).source_location();
+                  out.put(",\"loc\":[");
+                  out.put(static_cast<long long>(loc.file));
+                  out.put(',');
+                  out.put(static_cast<long long>(loc.line));
+                  out.put(',');
+                  out.put(static_cast<long long>(loc.column));
+                  out.put(']');
+               }
+               if (is_udt(n.category)) {
+                  const Udt& t = static_cast<const Udt&>(n);
+                  if (n.category == class_cat)
+                     list(",\"bases\":", static_cast<const Class&>(t).bases());
+                  list(",\"members\":", t.scope().members());
+               }
+               out.put("}\n");
+               ++count;
+            }
+
+            void run(const ipr::Node& root)
+            {
+               reach(root);
+               while (not stack.empty()) {
+                  const ipr::Node& n = *stack.back();
+                  stack.pop_back();
+                  if (options.categories.test(n.category))
+                     record(n);
+                  // Push operands in reverse, so that they are
+                  // written in order.
+                  std::size_t mark = stack.size();
+                  for_each_part(n, [&](const Node& x) { reach(x); });
+                  std::reverse(stack.begin() + mark, stack.end());
+               }
+            }
+         };
+      }
+
+      std::size_t
+      write(std::ostream& os, const ipr::Translation_unit& unit,
+            const Options& options)
+      {
+         Exporter x { os, options };
+         x.run(unit.global_namespace());
+         x.out.flush();
+         return x.count;
+      }
+   }
+}
@@ -0,0 +1,390 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/symbols>
+#include <ipr/image>
+#include <ipr/io>
+#include <ipr/property>
+#include <ipr/traversal>
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace ipr {
+   namespace symbols {
+      const char magic[8] = { 'I', 'P', 'R', 'S', 'Y', 'M', 'B', 'S' };
+
+      namespace {
+         [[noreturn]] void
+         corrupted()
+         {
+            throw std::domain_error("ipr::symbols: corrupted index");
+         }
+
+         [[noreturn]] void
+         mismatch()
+         {
+            throw std::domain_error("ipr::symbols: index does not match "
+                                    "the unit");
+         }
+
+         // FNV-1a.
+         Word
+         hash(const char* s, std::size_t n)
+         {
+            Word h = 2166136261u;
+            for (std::size_t i = 0; i < n; ++i)
+               h = (h ^ static_cast<unsigned char>(s[i])) * 16777619u;
+            return h;
+         }
+
+         // The scope entered at a declaration, if any.
+         inline const ipr::Scope*
+         inner_scope(const ipr::Decl& d)
+         {
+            const ipr::Udt* t = defined_udt(d);
+            return t != nullptr ? &t->scope() : nullptr;
+         }
+
+         void
+         spell(std::string& s, const ipr::Name& n)
+         {
+            if (n.category == identifier_cat) {
+               const String& t = static_cast<const Identifier&>(n).string();
+               s.append(t.begin(), t.end());
+            }
+            else {
+               std::ostringstream os;
+               Printer pp { os };
+               pp << xpr_expr(n);
+               s += os.str();
+            }
+         }
+
+         // A declaration reached, with its qualified name.
+         struct Symbol {
+            std::string name;
+            Word path;
+         };
+
+         // Mark the declarations whose scopes are entered: of those
+         // that enter the same scope, as those of a namespace that is
+         // reopened, the first reached in a walk from the global
+         // scope.  Parts walked concurrently thus enter each scope
+         // once between them, as a single walk would.
+         void
+         mark_entries(const ipr::Scope& s, Node_set& scopes, Node_set& decls)
+         {
+            for (int i = 0, n = s.size(); i < n; ++i) {
+               const ipr::Decl& d = s[i];
+               if (const ipr::Scope* inner = inner_scope(d))
+                  if (scopes.insert(*inner)) {
+                     decls.insert(d);
+                     mark_entries(*inner, scopes, decls);
+                  }
+            }
+         }
+
+         // The declarations of a part of the global scope, and of the
+         // scopes they enter.  Paths refer to their parents by their
+         // rank in the part.
+         struct Part {
+            const Node_set& entries;
+            std::vector<Symbol> symbols;
+            std::vector<Word> paths;
+            std::vector<const ipr::Decl*> decls;
+
+            explicit Part(const Node_set& e) : entries(e) { }
+
+            void walk(const ipr::Scope& s, Word parent,
+                      const std::string& prefix, int first, int last)
+            {
+               for (int i = first; i < last; ++i) {
+                  const ipr::Decl& d = s[i];
+                  const Word path = decls.size();
+                  decls.push_back(&d);
+                  paths.push_back(parent);
+                  paths.push_back(i);
+                  std::string name = prefix;
+                  spell(name, d.name());
+                  if (entries.contains(d)) {
+                     const ipr::Scope& inner = *inner_scope(d);
+                     walk(inner, path, name + "::", 0, inner.size());
+                  }
+                  symbols.push_back({ std::move(name), path });
+               }
+            }
+         };
+
+         struct Named {
+            Word hash;
+            Word path;
+            const std::string* name;
+
+            bool operator<(const Named& x) const
+            {
+               if (hash != x.hash)
+                  return hash < x.hash;
+               if (*name != *x.name)
+                  return *name < *x.name;
+               return path < x.path;
+            }
+         };
+      }
+
+      Index::Index(const ipr::Translation_unit& u, const Options& options)
+            : unit(u)
+      {
+         const ipr::Scope& global = unit.global_namespace().scope();
+         const int n = global.size();
+         int threads = options.threads > 0 ? options.threads
+            : int(std::thread::hardware_concurrency());
+         threads = std::max(1, std::min(threads, n));
+
+         Node_set scopes;
+         Node_set entries;
+         scopes.insert(global);
+         mark_entries(global, scopes, entries);
+         std::vector<Part> parts(threads, Part(entries));
+         if (threads == 1)
+            parts[0].walk(global, none, std::string(), 0, n);
+         else {
+            std::vector<std::exception_ptr> errors(threads);
+            std::vector<std::thread> workers;
+            for (int i = 0; i < threads; ++i)
+               workers.emplace_back([&, i] {
+                     try {
+                        parts[i].walk(global, none, std::string(),
+                                      n * i / threads, n * (i + 1) / threads);
+                     }
+                     catch (...) {
+                        errors[i] = std::current_exception();
+                     }
+                  });
+            for (auto& t : workers)
+               t.join();
+            for (auto& e : errors)
+               if (e)
+                  std::rethrow_exception(e);
+         }
+
+         // Number the paths of all parts in turn, then order them by
+         // name, so that the declarations of a name are contiguous.
+         std::vector<Named> named;
+         std::vector<Word> parent;
+         std::vector<Word> position;
+         std::vector<const ipr::Decl*> decls;
+         for (auto& p : parts) {
+            const Word base = decls.size();
+            for (auto& s : p.symbols)
+               named.push_back({ hash(s.name.data(), s.name.size()),
+                                 base + s.path, &s.name });
+            for (std::size_t i = 0; i < p.paths.size(); i += 2) {
+               parent.push_back(p.paths[i] == none ? none
+                                : base + p.paths[i]);
+               position.push_back(p.paths[i + 1]);
+            }
+            decls.insert(decls.end(), p.decls.begin(), p.decls.end());
+            p.decls.clear();
+            p.decls.shrink_to_fit();
+         }
+         std::sort(named.begin(), named.end());
+         const Word path_count = named.size();
+         std::vector<Word> rank(path_count);
+         for (Word i = 0; i < path_count; ++i)
+            rank[named[i].path] = i;
+
+         Word entry_count = 0;
+         std::size_t name_bytes = 0;
+         for (Word i = 0; i < path_count; ++i)
+            if (i == 0 or *named[i].name != *named[i - 1].name) {
+               ++entry_count;
+               name_bytes += named[i].name->size();
+            }
+         Word slot_count = 1;
+         while (slot_count < 2 * entry_count)
+            slot_count *= 2;
+
+         const std::size_t header_words = sizeof (Header) / sizeof (Word);
+         storage.assign(header_words + slot_count
+                        + std::size_t(entry_count) * Entry_words
+                        + std::size_t(path_count) * 2
+                        + (name_bytes + sizeof (Word) - 1) / sizeof (Word),
+                        none);
+         Header& h = *reinterpret_cast<Header*>(storage.data());
+         std::copy(magic, magic + sizeof magic, h.magic);
+         h.version = version;
+         h.byte_order = byte_order;
+         h.slot_count = slot_count;
+         h.entry_count = entry_count;
+         h.path_count = path_count;
+         h.name_bytes = name_bytes;
+
+         Word* slot = storage.data() + header_words;
+         Word* entry = slot + slot_count;
+         Word* path = entry + std::size_t(entry_count) * Entry_words;
+         char* chars = reinterpret_cast<char*>
+            (path + std::size_t(path_count) * 2);
+         std::fill(chars, reinterpret_cast<char*>
+                   (storage.data() + storage.size()), 0);
+         Word e = 0;
+         Word offset = 0;
+         for (Word i = 0; i < path_count; ++i) {
+            const Named& x = named[i];
+            if (i == 0 or *x.name != *named[i - 1].name) {
+               Word* w = entry + std::size_t(e) * Entry_words;
+               w[0] = x.hash;
+               w[1] = offset;
+               w[2] = x.name->size();
+               w[3] = i;
+               w[4] = 0;
+               std::copy(x.name->begin(), x.name->end(), chars + offset);
+               offset += x.name->size();
+               Word s = x.hash & (slot_count - 1);
+               while (slot[s] != none)
+                  s = (s + 1) & (slot_count - 1);
+               slot[s] = e++;
+            }
+            ++entry[std::size_t(e - 1) * Entry_words + 4];
+            const Word p = parent[x.path];
+            path[2 * i] = p == none ? none : rank[p];
+            path[2 * i + 1] = position[x.path];
+         }
+
+         attach(storage.data(), storage.size() * sizeof (Word));
+         for (Word i = 0; i < path_count; ++i)
+            resolved[i].store(decls[named[i].path],
+                              std::memory_order_relaxed);
+      }
+
+      Index::Index(const void* p, std::size_t n,
+                   const ipr::Translation_unit& u)
+            : unit(u)
+      {
+         attach(p, n);
+      }
+
+      Index::Index(const std::string& path, const ipr::Translation_unit& u)
+            : unit(u), file(new image::Mapped_file(path))
+      {
+         attach(file->data(), file->size());
+      }
+
+      Index::~Index() = default;
+
+      void
+      Index::attach(const void* p, std::size_t n)
+      {
+         if (p == nullptr or n < sizeof (Header)
+             or reinterpret_cast<std::uintptr_t>(p) % alignof(Word) != 0)
+            corrupted();
+         header = static_cast<const Header*>(p);
+         if (std::memcmp(header->magic, magic, sizeof magic) != 0
+             or header->version != version)
+            throw std::domain_error("ipr::symbols: not an index");
+         if (header->byte_order != byte_order)
+            throw std::domain_error("ipr::symbols: foreign byte order");
+
+         const std::uint64_t padded =
+            (std::uint64_t(header->name_bytes) + sizeof (Word) - 1)
+            / sizeof (Word) * sizeof (Word);
+         const std::uint64_t total = sizeof (Header) + padded
+            + sizeof (Word) * (std::uint64_t(header->slot_count)
+                               + std::uint64_t(header->entry_count)
+                                 * Entry_words
+                               + std::uint64_t(header->path_count) * 2);
+         if (total != n or header->slot_count == 0
+             or (header->slot_count & (header->slot_count - 1)) != 0
+             or header->slot_count < header->entry_count)
+            corrupted();
+
+         length = n;
+         slots = reinterpret_cast<const Word*>(header + 1);
+         entries = slots + header->slot_count;
+         paths = entries + std::size_t(header->entry_count) * Entry_words;
+         names = reinterpret_cast<const char*>
+            (paths + std::size_t(header->path_count) * 2);
+         resolved.reset
+            (new std::atomic<const ipr::Decl*>[header->path_count]());
+      }
+
+      Index::Decls
+      Index::lookup(const char* s, std::size_t n) const
+      {
+         const Word h = hash(s, n);
+         const Word mask = header->slot_count - 1;
+         for (Word i = h & mask, probes = 0; probes <= mask;
+              i = (i + 1) & mask, ++probes) {
+            const Word e = slots[i];
+            if (e == none)
+               break;
+            if (e >= header->entry_count)
+               corrupted();
+            const Word* w = entries + std::size_t(e) * Entry_words;
+            if (w[0] != h or w[2] != n)
+               continue;
+            if (std::uint64_t(w[1]) + w[2] > header->name_bytes
+                or std::uint64_t(w[3]) + w[4] > header->path_count)
+               corrupted();
+            if (std::memcmp(names + w[1], s, n) == 0)
+               return { this, w[3], w[4] };
+         }
+         return { this, 0, 0 };
+      }
+
+      // A path is resolved after the path of its enclosing scope.  A
+      // chain of enclosing scopes longer than the number of paths can
+      // only come from a corrupted index.
+      const ipr::Decl&
+      Index::resolve(Word p, Word depth) const
+      {
+         if (p >= header->path_count or depth > header->path_count)
+            corrupted();
+         if (const ipr::Decl* d = resolved[p].load(std::memory_order_acquire))
+            return *d;
+         const Word parent = paths[2 * p];
+         const Word position = paths[2 * p + 1];
+         const ipr::Scope* s = &unit.global_namespace().scope();
+         if (parent != none) {
+            s = inner_scope(resolve(parent, depth + 1));
+            if (s == nullptr)
+               mismatch();
+         }
+         if (position >= Word(s->size()))
+            mismatch();
+         const ipr::Decl& d = (*s)[int(position)];
+         resolved[p].store(&d, std::memory_order_release);
+         return d;
+      }
+
+      const ipr::Decl&
+      Index::Decls::operator[](int i) const
+      {
+         if (i < 0 or Word(i) >= count)
+            throw std::domain_error("ipr::symbols: index out of range");
+         return index->resolve(first + i, 0);
+      }
+
+      void
+      Index::save(std::ostream& os) const
+      {
+         os.write(reinterpret_cast<const char*>(header), length);
+      }
+
+      void
+      Index::save(const std::string& path) const
+      {
+         std::ofstream os(path, std::ios::binary);
+         if (not os)
+            throw std::domain_error("ipr::symbols: cannot create " + path);
+         save(os);
+      }
+   }
+}
@@ -894,3 +894,218 @@ ipr::Translation_unit::Visitor::visit(const Interface_unit& u)
 {
    visit(as<Translation_unit>(u));
 }
+
+// -- ipr::visit_operands --
+namespace ipr {
+   namespace {
+      // Abstract categories, and nodes without operands (strings,
+      // regions, user-defined types, break- and continue-statements),
+      // present nothing.  Declarations are handled at the level of
+      // Decl; the few that differ override that default.
+      struct operand_visitor : Visitor {
+         Operand_sink& out;
+         explicit operand_visitor(Operand_sink& s) : out(s) { }
+
+         template<class Cat, class Op>
+         void unary(const Unary<Cat, Op>& x) { out(x.operand()); }
+
+         template<class Cat, class Op1, class Op2>
+         void binary(const Binary<Cat, Op1, Op2>& x)
+         {
+            out(x.first());
+            out(x.second());
+         }
+
+         template<class Cat, class Op1, class Op2, class Op3>
+         void ternary(const Ternary<Cat, Op1, Op2, Op3>& x)
+         {
+            out(x.first());
+            out(x.second());
+            out(x.third());
+         }
+
+         template<class T>
+         void sequence(const Sequence<T>& s)
+         {
+            for (auto& x : s)
+               out(x);
+         }
+
+         void visit(const Node&) override { }
+         void visit(const Expr&) override { }
+         void visit(const Type&) override { }
+         void visit(const Stmt&) override { }
+
+         void visit(const Annotation& x) override { binary(x); }
+         void visit(const Comment& x) override { unary(x); }
+         void visit(const Linkage& x) override { unary(x); }
+
+         void visit(const Identifier& x) override { unary(x); }
+         void visit(const Operator& x) override { unary(x); }
+         void visit(const Conversion& x) override { unary(x); }
+         void visit(const Scope_ref& x) override { binary(x); }
+         void visit(const Template_id& x) override { binary(x); }
+         void visit(const Type_id& x) override { unary(x); }
+         void visit(const Ctor_name& x) override { unary(x); }
+         void visit(const Dtor_name& x) override { unary(x); }
+         void visit(const Rname& x) override { out(x.type()); }
+
+         void visit(const Array& x) override { binary(x); }
+         void visit(const Decltype& x) override { unary(x); }
+         void visit(const As_type& x) override { binary(x); }
+         void visit(const Function& x) override
+         {
+            out(x.source());
+            out(x.target());
+            out(x.throws());
+            out(x.lang_linkage());
+         }
+         void visit(const Pointer& x) override { unary(x); }
+         void visit(const Ptr_to_member& x) override { binary(x); }
+         void visit(const Product& x) override { sequence(x.elements()); }
+         void visit(const Qualified& x) override { out(x.main_variant()); }
+         void visit(const Reference& x) override { unary(x); }
+         void visit(const Rvalue_reference& x) override { unary(x); }
+         void visit(const Sum& x) override { sequence(x.elements()); }
+         void visit(const Template& x) override { binary(x); }
+
+         void visit(const Expr_list& x) override { sequence(x.elements()); }
+         void visit(const Initializer_list& x) override { unary(x); }
+
+         void visit(const Address& x) override { unary(x); }
+         void visit(const Array_delete& x) override { unary(x); }
+         void visit(const Complement& x) override { unary(x); }
+         void visit(const Delete& x) override { unary(x); }
+         void visit(const Deref& x) override { unary(x); }
+         void visit(const Paren_expr& x) override { unary(x); }
+         void visit(const Sizeof& x) override { unary(x); }
+         void visit(const Expr_stmt& x) override { unary(x); }
+         void visit(const Typeid& x) override { unary(x); }
+         void visit(const Id_expr& x) override { unary(x); }
+         void visit(const Label& x) override { unary(x); }
+         void visit(const Not& x) override { unary(x); }
+         void visit(const Post_decrement& x) override { unary(x); }
+         void visit(const Post_increment& x) override { unary(x); }
+         void visit(const Pre_decrement& x) override { unary(x); }
+         void visit(const Pre_increment& x) override { unary(x); }
+         void visit(const Throw& x) override { unary(x); }
+         void visit(const Unary_minus& x) override { unary(x); }
+         void visit(const Unary_plus& x) override { unary(x); }
+         void visit(const Expansion& x) override { unary(x); }
+
+         void visit(const And& x) override { binary(x); }
+         void visit(const Array_ref& x) override { binary(x); }
+         void visit(const Arrow& x) override { binary(x); }
+         void visit(const Arrow_star& x) override { binary(x); }
+         void visit(const Assign& x) override { binary(x); }
+         void visit(const Bitand& x) override { binary(x); }
+         void visit(const Bitand_assign& x) override { binary(x); }
+         void visit(const Bitor& x) override { binary(x); }
+         void visit(const Bitor_assign& x) override { binary(x); }
+         void visit(const Bitxor& x) override { binary(x); }
+         void visit(const Bitxor_assign& x) override { binary(x); }
+         void visit(const Cast& x) override { binary(x); }
+         void visit(const Call& x) override { binary(x); }
+         void visit(const Comma& x) override { binary(x); }
+         void visit(const Const_cast& x) override { binary(x); }
+         void visit(const Datum& x) override { binary(x); }
+         void visit(const Div& x) override { binary(x); }
+         void visit(const Div_assign& x) override { binary(x); }
+         void visit(const Dot& x) override { binary(x); }
+         void visit(const Dot_star& x) override { binary(x); }
+         void visit(const Dynamic_cast& x) override { binary(x); }
+         void visit(const Equal& x) override { binary(x); }
+         void visit(const Greater& x) override { binary(x); }
+         void visit(const Greater_equal& x) override { binary(x); }
+         void visit(const Less& x) override { binary(x); }
+         void visit(const Less_equal& x) override { binary(x); }
+         void visit(const Literal& x) override { binary(x); }
+         void visit(const Lshift& x) override { binary(x); }
+         void visit(const Lshift_assign& x) override { binary(x); }
+         void visit(const Member_init& x) override { binary(x); }
+         void visit(const Minus& x) override { binary(x); }
+         void visit(const Minus_assign& x) override { binary(x); }
+         void visit(const Modulo& x) override { binary(x); }
+         void visit(const Modulo_assign& x) override { binary(x); }
+         void visit(const Mul& x) override { binary(x); }
+         void visit(const Mul_assign& x) override { binary(x); }
+         void visit(const Not_equal& x) override { binary(x); }
+         void visit(const Or& x) override { binary(x); }
+         void visit(const Plus& x) override { binary(x); }
+         void visit(const Plus_assign& x) override { binary(x); }
+         void visit(const Reinterpret_cast& x) override { binary(x); }
+         void visit(const Rshift& x) override { binary(x); }
+         void visit(const Rshift_assign& x) override { binary(x); }
+         void visit(const Static_cast& x) override { binary(x); }
+
+         void visit(const Conditional& x) override { ternary(x); }
+         void visit(const New& x) override
+         {
+            if (auto p = x.placement())
+               out(p.get());
+            out(x.allocated_type());
+            if (auto i = x.initializer())
+               out(i.get());
+         }
+         void visit(const Mapping& x) override
+         {
+            out(x.params());
+            out(x.result_type());
+            out(x.result());
+         }
+
+         void visit(const Labeled_stmt& x) override { binary(x); }
+         void visit(const Block& x) override
+         {
+            sequence(x.body());
+            sequence(x.handlers());
+         }
+         void visit(const Ctor_body& x) override { binary(x); }
+         void visit(const If_then& x) override { binary(x); }
+         void visit(const If_then_else& x) override { ternary(x); }
+         void visit(const Switch& x) override { binary(x); }
+         void visit(const While& x) override { binary(x); }
+         void visit(const Do& x) override { binary(x); }
+         void visit(const For& x) override
+         {
+            out(x.initializer());
+            out(x.condition());
+            out(x.increment());
+            out(x.body());
+         }
+         void visit(const For_in& x) override
+         {
+            out(x.variable());
+            out(x.sequence());
+            out(x.body());
+         }
+         void visit(const Goto& x) override { unary(x); }
+         void visit(const Return& x) override { unary(x); }
+         void visit(const Handler& x) override { binary(x); }
+         void visit(const Empty_stmt&) override { }
+
+         void visit(const Decl& x) override
+         {
+            out(x.name());
+            out(x.type());
+            if (auto i = x.initializer())
+               out(i.get());
+         }
+         void visit(const Base_type& x) override { out(x.type()); }
+         void visit(const Bitfield& x) override
+         {
+            visit(as<Decl>(x));
+            out(x.precision());
+         }
+         void visit(const Parameter_list& x) override { sequence(x); }
+         void visit(const Asm& x) override { out(x.text()); }
+      };
+   }
+
+   void
+   visit_operands(const Node& n, Operand_sink& s)
+   {
+      operand_visitor v { s };
+      n.accept(v);
+   }
+}
@@ -16,11 +16,70 @@ ipr::util::string::operator[](int i) const
    return data[i];
 }
 
+// The undo log recording the insertions made in this thread.
+static thread_local ipr::util::undo_log* current_log = nullptr;
+
+ipr::util::undo_log::~undo_log()
+{
+   if (is_active)
+      deactivate();
+}
+
+ipr::util::undo_log*
+ipr::util::undo_log::active()
+{
+   return current_log;
+}
+
+void
+ipr::util::undo_log::activate()
+{
+   if (is_active)
+      throw std::logic_error("undo_log already active");
+   previous = current_log;
+   current_log = this;
+   is_active = true;
+}
+
+void
+ipr::util::undo_log::deactivate()
+{
+   for (undo_log** p = &current_log; *p != nullptr; p = &(*p)->previous)
+      if (*p == this) {
+         *p = previous;
+         break;
+      }
+   previous = nullptr;
+   is_active = false;
+}
+
+void
+ipr::util::undo_log::rewind(std::size_t n)
+{
+   // Undoing an insertion may destroy nodes, but inserts nothing; do
+   // not let that be recorded in any log.
+   undo_log* saved = current_log;
+   current_log = nullptr;
+   while (entries.size() > n) {
+      const entry e = entries.back();
+      entries.pop_back();
+      e.undo(e.target, e.arg);
+   }
+   current_log = saved;
+}
+
+void
+ipr::util::undo_log::clear()
+{
+   std::vector<entry>().swap(entries);
+}
+
 ipr::util::string::arena::arena()
       : mem(static_cast<pool*>(operator new(poolsz))),
         next_header(mem->storage)
 {
    mem->previous = 0;
+   mem->resume = 0;
 }
 
 ipr::util::string::arena::~arena()
@@ -30,6 +89,11 @@ ipr::util::string::arena::~arena()
       mem = mem->previous;
       operator delete (cur);
    }
+   while (large != 0) {
+      pool* cur = large;
+      large = large->previous;
+      operator delete (cur);
+   }
 }
 
 // Allocate storage sufficient to hold an immutable string of length "n".
@@ -37,7 +101,7 @@ ipr::util::string::arena::~arena()
 ipr::util::string*
 ipr::util::string::arena::allocate(int n)
 {
-   const int m = (n - string::padding_count + headersz - 1) / headersz + 1;
+   const int m = header_count(n);
    string* header;
 
    // If we have enough space left, juts grab it.
@@ -52,8 +116,8 @@ ipr::util::string::arena::allocate(int n)
          (operator new(poolsz + (n - bufsz)));
       header = new_pool->storage;
 
-      new_pool->previous = mem->previous;
-      mem->previous = new_pool;
+      new_pool->previous = large;
+      large = new_pool;
    }
    // Not enough space left.  Take the bet that, there does not
    // remain sufficient room in the buffer.  This is likely so if
@@ -61,6 +125,7 @@ ipr::util::string::arena::allocate(int n)
    else {
       pool* new_pool = static_cast<pool*>(operator new(poolsz));
       new_pool->previous = mem;
+      new_pool->resume = next_header;
       mem = new_pool;
 
       header = mem->storage;
@@ -80,5 +145,35 @@ ipr::util::string::arena::make_string(const char* s, int n)
    // Put cast to avoid gettinch assert with safe STL in MSVC
    std::copy(s, s + n, (char*)header->data);
    // <<<< Yuriy Solodkyy: 2007/05/29 
+   log_undo(&arena::undo_make, this, std::uintptr_t(header));
    return header;
 }
+
+// Strings are given back in the reverse order of their making.  A
+// pool left empty is given back, and allocation resumes where it left
+// off in the previous pool.
+
+void
+ipr::util::string::arena::release(string* header)
+{
+   if (large != 0 and header == large->storage) {
+      pool* p = large;
+      large = p->previous;
+      operator delete (p);
+   }
+   else if (header + header_count(header->length) == next_header) {
+      next_header = header;
+      if (header == mem->storage and mem->previous != 0) {
+         pool* p = mem;
+         mem = p->previous;
+         next_header = p->resume;
+         operator delete (p);
+      }
+   }
+}
+
+void
+ipr::util::string::arena::undo_make(void* self, std::uintptr_t header)
+{
+   static_cast<arena*>(self)->release(reinterpret_cast<string*>(header));
+}
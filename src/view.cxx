@@ -0,0 +1,1564 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/image>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+namespace ipr {
+   namespace image {
+      namespace {
+         using Word = Image::Word;
+
+         [[noreturn]] void
+         corrupted()
+         {
+            throw std::domain_error("ipr::image: corrupted image");
+         }
+
+         [[noreturn]] void
+         unrecorded()
+         {
+            throw std::domain_error("ipr::image: property not recorded");
+         }
+
+         // Spellings of the builtin types, in image order.  Images
+         // record builtin types by rank in this table.
+         const char* const builtin_names[] = {
+            "void", "bool", "char", "signed char", "unsigned char",
+            "wchar_t", "short", "unsigned short", "int", "unsigned int",
+            "long", "unsigned long", "long long", "unsigned long long",
+            "float", "double", "long double", "...",
+            "typename", "class", "union", "enum", "namespace"
+         };
+         constexpr Word builtin_count =
+            sizeof builtin_names / sizeof builtin_names[0];
+         constexpr Word typename_index = 18;
+         constexpr Word namespace_index = 22;
+
+         // The node type designated by an operand type.
+         template<class T>
+         using Target = typename std::remove_cv<
+            typename std::remove_reference<T>::type>::type;
+
+         // A table of pointers, indexed by node index, whose storage
+         // is allocated by chunks as indices are used.
+         template<class T>
+         struct Lazy_table {
+            static constexpr Word bits = 10;
+
+            const T*& operator[](Word w)
+            {
+               const Word c = w >> bits;
+               if (c >= chunks.size())
+                  chunks.resize(c + 1);
+               if (chunks[c] == nullptr)
+                  chunks[c].reset(new const T*[1 << bits]());
+               return chunks[c][w & ((1 << bits) - 1)];
+            }
+
+         private:
+            std::vector<std::unique_ptr<const T*[]>> chunks;
+         };
+
+         // Storage for proxies, released all at once.  Proxies are
+         // trivially destructible.
+         struct Arena {
+            template<class T, class... Args>
+            T* make(Args&&... args)
+            {
+               static_assert(std::is_trivially_destructible<T>::value,
+                             "proxies are not destroyed");
+               ipr::Node_registry::Pause transient;
+               return new (allocate(sizeof (T))) T(args...);
+            }
+
+            Word* words(std::size_t n)
+            {
+               return static_cast<Word*>(allocate(n * sizeof(Word)));
+            }
+
+         private:
+            static constexpr std::size_t block_size = 64 * 1024;
+            std::vector<std::unique_ptr<char[]>> blocks;
+            char* next = nullptr;
+            std::size_t left = 0;
+
+            void* allocate(std::size_t n)
+            {
+               constexpr std::size_t align = alignof(std::max_align_t);
+               n = (n + align - 1) / align * align;
+               if (n > left) {
+                  const std::size_t size = n > block_size ? n : block_size;
+                  blocks.emplace_back(new char[size]);
+                  next = blocks.back().get();
+                  left = size;
+               }
+               void* p = next;
+               next += n;
+               left -= n;
+               return p;
+            }
+         };
+
+         template<class T>
+         struct Empty_sequence : ipr::Sequence<T> {
+            int size() const final { return 0; }
+            const T& get(int) const final { corrupted(); }
+         };
+
+         const Empty_sequence<ipr::Annotation> no_annotations { };
+         const Empty_sequence<ipr::Attribute> no_attributes { };
+         const Empty_sequence<ipr::Substitution> no_substitutions { };
+         const Empty_sequence<ipr::Decl> no_decls { };
+         const Empty_sequence<ipr::Module> no_modules { };
+         const ipr::Region::Location_span no_span { };
+         const ipr::Source_location no_source_location { };
+         const ipr::Unit_location no_unit_location { };
+      }
+
+      struct View::Rep {
+         const Image& image;
+         Arena arena;
+
+         explicit Rep(const Image&);
+
+         const Word* record(Word w) const { return image.node(w); }
+         Word link(Word w, Link l) const { return image.link(w, l); }
+
+         const ipr::Node& node(Word);
+
+         template<class T>
+         const T& get(Word w) { return static_cast<const T&>(node(w)); }
+
+         template<class T>
+         const T* linked(Word w, Link l)
+         {
+            const Word x = link(w, l);
+            return x == none ? nullptr : &get<T>(x);
+         }
+
+         const ipr::String& string(Word);
+         const ipr::Region& region(Word);
+         const ipr::Scope& scope(Word);
+         const ipr::Name& type_name(Word);
+         const ipr::Overload& overload(Word, Word);
+         const ipr::Sequence<ipr::Decl>& select(const ipr::Overload&,
+                                                const ipr::Type&);
+         const ipr::Linkage& cxx_linkage();
+         const ipr::Expr& phantom();
+         const ipr::Identifier& builtin_name(Word);
+         const ipr::Global_scope& global();
+
+         // The members of the node W, skipping base types.
+         std::pair<const Word*, const Word*> scope_members(Word);
+
+      private:
+         Lazy_table<ipr::Node> nodes;
+         Lazy_table<ipr::String> strings;
+         Lazy_table<ipr::Region> regions;
+         Lazy_table<ipr::Scope> scopes;
+         Lazy_table<ipr::Name> type_names;
+         std::unordered_map<std::uint64_t, const ipr::Overload*> overloads;
+         std::map<std::pair<const void*, const void*>,
+                  const ipr::Sequence<ipr::Decl>*> selections;
+         const ipr::Linkage* cxx = nullptr;
+         const ipr::Expr* empty = nullptr;
+         const ipr::Identifier* builtins[builtin_count] = { };
+         Word global_index;
+
+         const ipr::Node* decode(Word);
+      };
+
+      namespace {
+         using Rep = View::Rep;
+
+         // -- Synthesized nodes --
+         // Nodes that an impl::Lexicon creates implicitly, and that
+         // images therefore do not record.
+
+         struct Text : ipr::String {
+            const char* const first;
+            const int length;
+
+            Text(const char* s, int n) : first(s), length(n) { }
+            int size() const final { return length; }
+            iterator begin() const final { return first; }
+            iterator end() const final { return first + length; }
+            void accept(ipr::Visitor& v) const final { v.visit(*this); }
+         };
+
+         struct Made_identifier : ipr::Identifier {
+            const ipr::String& text;
+
+            explicit Made_identifier(const ipr::String& s) : text(s) { }
+            const ipr::String& operand() const final { return text; }
+            const ipr::Type& type() const final { unrecorded(); }
+            void accept(ipr::Visitor& v) const final { v.visit(*this); }
+         };
+
+         struct Made_linkage : ipr::Linkage {
+            const ipr::String& text;
+
+            explicit Made_linkage(const ipr::String& s) : text(s) { }
+            const ipr::String& operand() const final { return text; }
+            void accept(ipr::Visitor& v) const final { v.visit(*this); }
+         };
+
+         struct Made_type_id : ipr::Type_id {
+            const ipr::Type& id;
+
+            explicit Made_type_id(const ipr::Type& t) : id(t) { }
+            const ipr::Type& operand() const final { return id; }
+            const ipr::Type& type() const final { return id.type(); }
+            void accept(ipr::Visitor& v) const final { v.visit(*this); }
+         };
+
+         struct Made_phantom : ipr::Phantom {
+            const ipr::Type& type() const final { unrecorded(); }
+            void accept(ipr::Visitor& v) const final { v.visit(*this); }
+         };
+
+         // -- Sequences --
+         template<class T>
+         struct Word_sequence : ipr::Sequence<T> {
+            Rep& rep;
+            const Word* const first;
+            const int count;
+
+            Word_sequence(Rep& r, const Word* p, int n)
+                  : rep(r), first(p), count(n) { }
+            Word_sequence(Rep& r, std::pair<const Word*, const Word*> p)
+                  : rep(r), first(p.first), count(p.second - p.first) { }
+
+            int size() const final { return count; }
+            const T& get(int i) const final
+            {
+               if (i < 0 or i >= count)
+                  corrupted();
+               return rep.get<T>(first[i]);
+            }
+         };
+
+         // -- Proxy --
+         // The common part of proxies for image nodes: the node index
+         // and the decoding of operands.
+         template<class T>
+         struct Proxy : T {
+            Rep& rep;
+            const Word self;
+
+            Proxy(Rep& r, Word w) : rep(r), self(w) { }
+
+            void accept(ipr::Visitor& v) const final { v.visit(*this); }
+
+            Word arg(Word i) const
+            {
+               const Word* r = rep.record(self);
+               if (i >= r[1])
+                  corrupted();
+               return r[2 + i];
+            }
+
+            template<class U>
+            const U& get(Word i) const { return rep.get<U>(arg(i)); }
+
+            template<class U>
+            const U* get_opt(Word i) const
+            {
+               const Word w = arg(i);
+               return w == none ? nullptr : &rep.get<U>(w);
+            }
+
+            template<class U>
+            const U& linked(Link l) const
+            {
+               return *util::check(rep.linked<U>(self, l));
+            }
+         };
+
+         // Expressions whose type is recorded as their operand K.
+         template<class T, Word K>
+         struct Typed : Proxy<T> {
+            using Proxy<T>::Proxy;
+            const ipr::Type& type() const final
+            {
+               return *util::check(this->template get_opt<ipr::Type>(K));
+            }
+         };
+
+         // Classic expressions, for which an overloaded operator
+         // implementation is recorded as a back reference.
+         template<class B>
+         struct Classic : B {
+            using B::B;
+            Optional<ipr::Decl> implementation() const final
+            {
+               return this->rep.template linked<ipr::Decl>(this->self,
+                                                           ref_link);
+            }
+         };
+
+         template<class T, Word K = 1>
+         struct Unary : Typed<T, K> {
+            using Typed<T, K>::Typed;
+            typename T::Arg_type operand() const final
+            {
+               return this->template get<Target<typename T::Arg_type>>(0);
+            }
+         };
+
+         template<class T, Word K = 2>
+         struct Binary : Typed<T, K> {
+            using Typed<T, K>::Typed;
+            typename T::Arg1_type first() const final
+            {
+               return this->template get<Target<typename T::Arg1_type>>(0);
+            }
+            typename T::Arg2_type second() const final
+            {
+               return this->template get<Target<typename T::Arg2_type>>(1);
+            }
+         };
+
+         template<class T>
+         using Classic_unary = Classic<Unary<T>>;
+
+         template<class T>
+         using Classic_binary = Classic<Binary<T>>;
+
+         // Cast-like expressions: their type is their first operand.
+         template<class T>
+         struct Conversion : Classic<Proxy<T>> {
+            using Classic<Proxy<T>>::Classic;
+            const ipr::Type& first() const final
+            {
+               return this->template get<ipr::Type>(0);
+            }
+            typename T::Arg2_type second() const final
+            {
+               return this->template get<Target<typename T::Arg2_type>>(1);
+            }
+            const ipr::Type& type() const final { return first(); }
+         };
+
+         // -- Names --
+         template<class T>
+         struct Text_name : Proxy<T> {
+            using Proxy<T>::Proxy;
+            const ipr::String& operand() const final
+            {
+               return this->rep.string(this->arg(0));
+            }
+            const ipr::Type& type() const final { unrecorded(); }
+         };
+
+         template<class T>
+         struct Type_name : Proxy<T> {
+            using Proxy<T>::Proxy;
+            const ipr::Type& operand() const final
+            {
+               return this->template get<ipr::Type>(0);
+            }
+            const ipr::Type& type() const final { unrecorded(); }
+         };
+
+         struct Linkage : Proxy<ipr::Linkage> {
+            using Proxy::Proxy;
+            const ipr::String& operand() const final
+            {
+               return rep.string(arg(0));
+            }
+         };
+
+         struct Id_expr : Proxy<ipr::Id_expr> {
+            using Proxy::Proxy;
+            const ipr::Name& operand() const final { return get<ipr::Name>(0); }
+            const ipr::Decl& resolution() const final
+            {
+               return linked<ipr::Decl>(ref_link);
+            }
+            const ipr::Type& type() const final
+            {
+               return resolution().type();
+            }
+         };
+
+         // -- Types --
+         template<class B>
+         struct Type : B {
+            using B::B;
+            const ipr::Name& name() const final
+            {
+               return this->rep.type_name(this->self);
+            }
+            const ipr::Type& type() const final
+            {
+               return this->rep.template get<ipr::Type>(typename_index);
+            }
+         };
+
+         template<class T>
+         struct Unary_type : Type<Proxy<T>> {
+            using Type<Proxy<T>>::Type;
+            typename T::Arg_type operand() const final
+            {
+               return this->template get<Target<typename T::Arg_type>>(0);
+            }
+         };
+
+         template<class T>
+         struct Binary_type : Type<Proxy<T>> {
+            using Type<Proxy<T>>::Type;
+            typename T::Arg1_type first() const final
+            {
+               return this->template get<Target<typename T::Arg1_type>>(0);
+            }
+            typename T::Arg2_type second() const final
+            {
+               return this->template get<Target<typename T::Arg2_type>>(1);
+            }
+         };
+
+         struct Function : Type<Proxy<ipr::Function>> {
+            using Type::Type;
+            const ipr::Product& first() const final
+            {
+               return get<ipr::Product>(0);
+            }
+            const ipr::Type& second() const final { return get<ipr::Type>(1); }
+            const ipr::Type& third() const final { return get<ipr::Type>(2); }
+            const ipr::Linkage& fourth() const final
+            {
+               return get<ipr::Linkage>(3);
+            }
+         };
+
+         struct Qualified : Type<Proxy<ipr::Qualified>> {
+            using Type::Type;
+            ipr::Type_qualifier first() const final
+            {
+               return ipr::Type_qualifier(arg(0));
+            }
+            const ipr::Type& second() const final { return get<ipr::Type>(1); }
+         };
+
+         // Product and Sum: the record lists the component types.
+         template<class T>
+         struct Type_list : Type<Proxy<T>> {
+            const Word_sequence<ipr::Type> seq;
+
+            Type_list(Rep& r, Word w)
+                  : Type<Proxy<T>>(r, w), seq(r, r.record(w) + 2,
+                                               r.record(w)[1])
+            { }
+            const ipr::Sequence<ipr::Type>& operand() const final
+            {
+               return seq;
+            }
+         };
+
+         struct Auto : Type<Proxy<ipr::Auto>> {
+            using Type::Type;
+         };
+
+         struct Builtin : Proxy<ipr::As_type> {
+            using Proxy::Proxy;
+            const ipr::Expr& first() const final
+            {
+               return rep.builtin_name(arg(0));
+            }
+            const ipr::Linkage& second() const final
+            {
+               return rep.cxx_linkage();
+            }
+            const ipr::Name& name() const final
+            {
+               return rep.builtin_name(arg(0));
+            }
+            const ipr::Type& type() const final
+            {
+               return rep.get<ipr::Type>(typename_index);
+            }
+         };
+
+         // -- User-defined types --
+         // Records of user-defined types are: enclosing region owner,
+         // name or none, type.
+         template<class T>
+         struct Udt : Proxy<T> {
+            using Proxy<T>::Proxy;
+            const ipr::Name& name() const final
+            {
+               return *util::check(this->template get_opt<ipr::Name>(1));
+            }
+            const ipr::Type& type() const final
+            {
+               return this->template get<ipr::Type>(2);
+            }
+            const ipr::Region& region() const final
+            {
+               return this->rep.region(this->self);
+            }
+         };
+
+         struct Class : Udt<ipr::Class> {
+            const Word_sequence<ipr::Base_type> base_seq;
+
+            Class(Rep& r, Word w) : Udt(r, w), base_seq(r, bases_of(r, w)) { }
+
+            const ipr::Sequence<ipr::Base_type>& bases() const final
+            {
+               return base_seq;
+            }
+
+            static std::pair<const Word*, const Word*>
+            bases_of(Rep& r, Word w)
+            {
+               auto all = r.image.members(w);
+               return { all.first, r.scope_members(w).first };
+            }
+         };
+
+         struct Enum : Udt<ipr::Enum> {
+            const Word_sequence<ipr::Enumerator> seq;
+
+            Enum(Rep& r, Word w) : Udt(r, w), seq(r, r.image.members(w)) { }
+
+            const ipr::Sequence<ipr::Enumerator>& members() const final
+            {
+               return seq;
+            }
+            Kind kind() const final { return Kind(arg(3)); }
+         };
+
+         struct Global : Proxy<ipr::Global_scope> {
+            const Text nothing { "", 0 };
+            const Made_identifier id { nothing };
+
+            using Proxy::Proxy;
+            const ipr::Name& name() const final { return id; }
+            const ipr::Type& type() const final
+            {
+               return rep.get<ipr::Type>(namespace_index);
+            }
+            const ipr::Region& region() const final
+            {
+               return rep.region(self);
+            }
+         };
+
+         // -- Regions and scopes --
+         // A region is designated by the node index of its owner.
+         template<class T>
+         struct Region : Proxy<T> {
+            using Proxy<T>::Proxy;
+            const ipr::Region::Location_span& span() const final
+            {
+               return no_span;
+            }
+            const ipr::Region& enclosing() const final
+            {
+               if (this->rep.record(this->self)[0] == global_tag)
+                  unrecorded();
+               return this->rep.region(this->arg(0));
+            }
+            const ipr::Scope& bindings() const final
+            {
+               return this->rep.scope(this->self);
+            }
+            const ipr::Expr& owner() const final
+            {
+               return this->rep.template get<ipr::Expr>(this->self);
+            }
+         };
+
+         struct Parameter_list : Region<ipr::Parameter_list> {
+            const Word_sequence<ipr::Parameter> seq;
+
+            Parameter_list(Rep& r, Word w)
+                  : Region(r, w), seq(r, r.image.members(w)) { }
+            int size() const final { return seq.size(); }
+            const ipr::Parameter& get(int i) const final { return seq[i]; }
+         };
+
+         struct Overload : ipr::Overload {
+            Rep& rep;
+            const Word_sequence<ipr::Decl> seq;
+
+            Overload(Rep& r, const Word* p, int n) : rep(r), seq(r, p, n) { }
+            int size() const final { return seq.size(); }
+            const ipr::Decl& get(int i) const final { return seq[i]; }
+            const ipr::Sequence<ipr::Decl>&
+            operator[](const ipr::Type& t) const final
+            {
+               return rep.select(*this, t);
+            }
+            const ipr::Type& type() const final { unrecorded(); }
+            void accept(ipr::Visitor& v) const final { v.visit(*this); }
+         };
+
+         struct Scope : Proxy<ipr::Scope> {
+            const Word_sequence<ipr::Decl> seq;
+
+            Scope(Rep& r, Word w) : Proxy(r, w), seq(r, r.scope_members(w)) { }
+            const ipr::Sequence<ipr::Decl>& members() const final
+            {
+               return seq;
+            }
+            const ipr::Overload& operator[](const ipr::Name&) const final;
+            const ipr::Type& type() const final { unrecorded(); }
+         };
+
+         // -- Expressions --
+         struct Literal : Proxy<ipr::Literal> {
+            using Proxy::Proxy;
+            const ipr::Type& first() const final { return get<ipr::Type>(0); }
+            const ipr::String& second() const final
+            {
+               return rep.string(arg(1));
+            }
+            const ipr::Type& type() const final { return first(); }
+            Optional<ipr::Decl> implementation() const final { return { }; }
+         };
+
+         struct Expr_list : Proxy<ipr::Expr_list> {
+            const Word_sequence<ipr::Expr> seq;
+
+            Expr_list(Rep& r, Word w)
+                  : Proxy(r, w), seq(r, r.record(w) + 2, r.record(w)[1]) { }
+            const ipr::Sequence<ipr::Expr>& operand() const final
+            {
+               return seq;
+            }
+            const ipr::Type& type() const final { unrecorded(); }
+         };
+
+         struct Phantom : Typed<ipr::Phantom, 0> {
+            using Typed::Typed;
+         };
+
+         struct Paren_expr : Classic<Proxy<ipr::Paren_expr>> {
+            using Classic::Classic;
+            const ipr::Expr& operand() const final
+            {
+               return get<ipr::Expr>(0);
+            }
+            const ipr::Type& type() const final { return operand().type(); }
+         };
+
+         struct Conditional : Classic<Typed<ipr::Conditional, 3>> {
+            using Classic::Classic;
+            const ipr::Expr& first() const final { return get<ipr::Expr>(0); }
+            const ipr::Expr& second() const final { return get<ipr::Expr>(1); }
+            const ipr::Expr& third() const final { return get<ipr::Expr>(2); }
+         };
+
+         struct New : Classic<Typed<ipr::New, 3>> {
+            using Classic::Classic;
+            Optional<ipr::Expr_list> placement() const final
+            {
+               return get_opt<ipr::Expr_list>(0);
+            }
+            const ipr::Type& allocated_type() const final
+            {
+               return get<ipr::Type>(1);
+            }
+            Optional<ipr::Expr_list> initializer() const final
+            {
+               return get_opt<ipr::Expr_list>(2);
+            }
+         };
+
+         // Records of mappings are: enclosing region owner, depth,
+         // type of the parameter list, type or none, value type or none.
+         struct Mapping : Typed<ipr::Mapping, 3> {
+            using Typed::Typed;
+            const ipr::Parameter_list& params() const final
+            {
+               return static_cast<const ipr::Parameter_list&>
+                  (rep.region(self));
+            }
+            const ipr::Type& result_type() const final
+            {
+               return *util::check(get_opt<ipr::Type>(4));
+            }
+            const ipr::Expr& result() const final
+            {
+               return linked<ipr::Expr>(init_link);
+            }
+            int depth() const final { return arg(1); }
+         };
+
+         // -- Statements --
+         template<class B>
+         struct Stmt : B {
+            mutable ipr::Source_location src;
+            mutable ipr::Unit_location unit;
+
+            using B::B;
+
+            const ipr::Unit_location& unit_location() const final
+            {
+               if (const Word* r = locus()) {
+                  unit.line = ipr::Line_number(r[6]);
+                  unit.column = ipr::Column_number(r[7]);
+                  unit.unit = ipr::Unit_index(r[8]);
+               }
+               return unit;
+            }
+            const ipr::Source_location& source_location() const final
+            {
+               if (const Word* r = locus()) {
+                  src.line = ipr::Line_number(r[3]);
+                  src.column = ipr::Column_number(r[4]);
+                  src.file = ipr::File_index(r[5]);
+               }
+               return src;
+            }
+            const ipr::Sequence<ipr::Annotation>& annotation() const final
+            {
+               return no_annotations;
+            }
+            const ipr::Sequence<ipr::Attribute>& attributes() const final
+            {
+               return no_attributes;
+            }
+
+         private:
+            // The locus record: tag, count, node, then the source
+            // and unit locations.
+            const Word* locus() const
+            {
+               const Word w = this->rep.link(this->self, locus_link);
+               if (w == none)
+                  return nullptr;
+               const Word* r = this->rep.image.record(w);
+               if (r[0] != locus_tag or r[1] != 7)
+                  corrupted();
+               return r;
+            }
+         };
+
+         // Statements whose type is that of their operand K.
+         template<class T, Word K>
+         struct Stmt_typed_by : Stmt<Proxy<T>> {
+            using Stmt<Proxy<T>>::Stmt;
+            const ipr::Type& type() const final
+            {
+               return this->template get<ipr::Expr>(K).type();
+            }
+         };
+
+         template<class T>
+         struct Unary_stmt : Stmt_typed_by<T, 0> {
+            using Stmt_typed_by<T, 0>::Stmt_typed_by;
+            const ipr::Expr& operand() const final
+            {
+               return this->template get<ipr::Expr>(0);
+            }
+         };
+
+         template<class T>
+         struct Binary_stmt : Stmt_typed_by<T, 1> {
+            using Stmt_typed_by<T, 1>::Stmt_typed_by;
+            typename T::Arg1_type first() const final
+            {
+               return this->template get<Target<typename T::Arg1_type>>(0);
+            }
+            typename T::Arg2_type second() const final
+            {
+               return this->template get<Target<typename T::Arg2_type>>(1);
+            }
+         };
+
+         struct Empty_stmt : Stmt<Proxy<ipr::Empty_stmt>> {
+            using Stmt::Stmt;
+            const ipr::Expr& operand() const final { return rep.phantom(); }
+            const ipr::Type& type() const final { return operand().type(); }
+         };
+
+         struct Ctor_body : Stmt<Typed<ipr::Ctor_body, 2>> {
+            using Stmt::Stmt;
+            const ipr::Expr_list& first() const final
+            {
+               return get<ipr::Expr_list>(0);
+            }
+            const ipr::Block& second() const final
+            {
+               return get<ipr::Block>(1);
+            }
+         };
+
+         struct If_then_else : Stmt<Typed<ipr::If_then_else, 3>> {
+            using Stmt::Stmt;
+            const ipr::Expr& first() const final { return get<ipr::Expr>(0); }
+            const ipr::Stmt& second() const final { return get<ipr::Stmt>(1); }
+            const ipr::Stmt& third() const final { return get<ipr::Stmt>(2); }
+         };
+
+         struct Block : Stmt<Proxy<ipr::Block>> {
+            const Word_sequence<ipr::Stmt> stmts;
+            const Word_sequence<ipr::Handler> handler_seq;
+
+            Block(Rep& r, Word w)
+                  : Stmt(r, w), stmts(r, body(r, w) + 4, body(r, w)[3]),
+                    handler_seq(r, body(r, w) + 5 + body(r, w)[3],
+                                body(r, w)[4 + body(r, w)[3]])
+            { }
+
+            const ipr::Scope& members() const final { return rep.scope(self); }
+            const ipr::Sequence<ipr::Stmt>& body() const final
+            {
+               return stmts;
+            }
+            const ipr::Sequence<ipr::Handler>& handlers() const final
+            {
+               return handler_seq;
+            }
+            const ipr::Type& type() const final { unrecorded(); }
+
+            // The body record: tag, count, block, statement count,
+            // statements, handler count, handlers.
+            static const Word*
+            body(Rep& r, Word w)
+            {
+               const Word b = r.link(w, body_link);
+               if (b == none)
+                  corrupted();
+               const Word* p = r.image.record(b);
+               if (p[0] != body_tag or p[1] < 2 or p[3] + 2 > p[1]
+                   or p[4 + p[3]] + p[3] + 3 != p[1])
+                  corrupted();
+               return p;
+            }
+         };
+
+         struct Break : Stmt<Proxy<ipr::Break>> {
+            using Stmt::Stmt;
+            const ipr::Stmt& from() const final
+            {
+               return linked<ipr::Stmt>(ref_link);
+            }
+            const ipr::Type& type() const final { return from().type(); }
+         };
+
+         struct Continue : Stmt<Proxy<ipr::Continue>> {
+            using Stmt::Stmt;
+            const ipr::Stmt& iteration() const final
+            {
+               return linked<ipr::Stmt>(ref_link);
+            }
+            const ipr::Type& type() const final { return iteration().type(); }
+         };
+
+         struct For : Stmt<Proxy<ipr::For>> {
+            using Stmt::Stmt;
+            const ipr::Expr& initializer() const final
+            {
+               return *util::check(get_opt<ipr::Expr>(0));
+            }
+            const ipr::Expr& condition() const final
+            {
+               return *util::check(get_opt<ipr::Expr>(1));
+            }
+            const ipr::Expr& increment() const final
+            {
+               return *util::check(get_opt<ipr::Expr>(2));
+            }
+            const ipr::Stmt& body() const final
+            {
+               return *util::check(get_opt<ipr::Stmt>(3));
+            }
+            const ipr::Type& type() const final { return body().type(); }
+         };
+
+         struct For_in : Stmt<Proxy<ipr::For_in>> {
+            using Stmt::Stmt;
+            const ipr::Var& variable() const final
+            {
+               return linked<ipr::Var>(ref_link);
+            }
+            const ipr::Expr& sequence() const final
+            {
+               return *util::check(get_opt<ipr::Expr>(0));
+            }
+            const ipr::Stmt& body() const final
+            {
+               return *util::check(get_opt<ipr::Stmt>(1));
+            }
+            const ipr::Type& type() const final { return body().type(); }
+         };
+
+         // The position of a declaration among the members of its
+         // owner, which are recorded in increasing order of index.
+         int
+         rank(std::pair<const Word*, const Word*> members, Word w)
+         {
+            const Word* p = std::lower_bound(members.first, members.second, w);
+            if (p == members.second or *p != w)
+               corrupted();
+            return p - members.first;
+         }
+
+         // -- Declarations --
+         // Records of most declarations are: home region owner, name,
+         // type, specifiers, lexical region owner or none.
+         template<class T>
+         struct Decl : Stmt<Proxy<T>> {
+            using Stmt<Proxy<T>>::Stmt;
+
+            ipr::DeclSpecifiers specifiers() const override
+            {
+               return ipr::DeclSpecifiers(this->arg(3));
+            }
+            const ipr::Linkage& lang_linkage() const final { unrecorded(); }
+            const ipr::Name& name() const override
+            {
+               return this->template get<ipr::Name>(1);
+            }
+            const ipr::Type& type() const override
+            {
+               return this->template get<ipr::Type>(2);
+            }
+            const ipr::Region& home_region() const final
+            {
+               return this->rep.region(this->arg(0));
+            }
+            const ipr::Region& lexical_region() const override
+            {
+               const Word w = this->arg(4);
+               return w == none ? home_region() : this->rep.region(w);
+            }
+            Optional<ipr::Expr> initializer() const override
+            {
+               return this->rep.template linked<ipr::Expr>(this->self,
+                                                           init_link);
+            }
+            const ipr::Named_map& generating_map() const final
+            {
+               unrecorded();
+            }
+            const ipr::Sequence<ipr::Substitution>&
+            substitutions() const final
+            {
+               return no_substitutions;
+            }
+            const ipr::Sequence<ipr::Decl>& decl_set() const override
+            {
+               return this->rep.select(this->rep.overload(this->arg(0),
+                                                          this->arg(1)),
+                                       type());
+            }
+            int position() const override
+            {
+               return rank(this->rep.scope_members(this->arg(0)), this->self);
+            }
+            const ipr::Decl& master() const final { return decl_set()[0]; }
+
+         protected:
+            // The declaration in the decl-set that has an initializer.
+            const ipr::Decl& defining() const
+            {
+               auto& set = static_cast<const Word_sequence<ipr::Decl>&>
+                  (Decl::decl_set());
+               for (int i = 0; i < set.size(); ++i)
+                  if (this->rep.link(set.first[i], init_link) != none)
+                     return set[i];
+               unrecorded();
+            }
+
+            // The body of the mapping that initializes a function or
+            // a named map.
+            Optional<ipr::Expr> body() const
+            {
+               const Word m = this->rep.link(this->self, init_link);
+               if (m == none)
+                  unrecorded();
+               return this->rep.template linked<ipr::Expr>(m, init_link);
+            }
+
+            const ipr::Udt& owning_udt() const
+            {
+               return this->rep.template get<ipr::Udt>(this->arg(0));
+            }
+         };
+
+         // Declarations that cannot be redeclared: their position is
+         // their rank among the members of their owner.
+         template<class T>
+         struct Unique_decl : Decl<T> {
+            using Decl<T>::Decl;
+            ipr::DeclSpecifiers specifiers() const override
+            {
+               return ipr::DeclSpecifiers::None;
+            }
+            const ipr::Region& lexical_region() const final
+            {
+               return this->home_region();
+            }
+            int position() const final
+            {
+               return rank(this->rep.image.members(this->arg(0)), this->self);
+            }
+         };
+
+         struct Var : Decl<ipr::Var> {
+            using Decl::Decl;
+         };
+
+         struct Alias : Decl<ipr::Alias> {
+            using Decl::Decl;
+            const ipr::Type& type() const final
+            {
+               return initializer().get().type();
+            }
+            Optional<ipr::Expr> initializer() const final
+            {
+               return &get<ipr::Expr>(2);
+            }
+         };
+
+         struct Field : Decl<ipr::Field> {
+            using Decl::Decl;
+            const ipr::Udt& membership() const final { return owning_udt(); }
+         };
+
+         struct Bitfield : Decl<ipr::Bitfield> {
+            using Decl::Decl;
+            const ipr::Expr& precision() const final
+            {
+               return *util::check(get_opt<ipr::Expr>(5));
+            }
+            const ipr::Udt& membership() const final { return owning_udt(); }
+         };
+
+         struct Typedecl : Decl<ipr::Typedecl> {
+            using Decl::Decl;
+            const ipr::Udt& membership() const final { return owning_udt(); }
+            const ipr::Typedecl& definition() const final
+            {
+               return static_cast<const ipr::Typedecl&>(defining());
+            }
+         };
+
+         struct Fundecl : Decl<ipr::Fundecl> {
+            using Decl::Decl;
+            const ipr::Udt& membership() const final { return owning_udt(); }
+            Optional<ipr::Expr> initializer() const final { return body(); }
+            const ipr::Mapping& mapping() const final
+            {
+               return linked<ipr::Mapping>(init_link);
+            }
+            const ipr::Fundecl& definition() const final
+            {
+               return static_cast<const ipr::Fundecl&>(defining());
+            }
+         };
+
+         struct Named_map : Decl<ipr::Named_map> {
+            using Decl::Decl;
+            const ipr::Named_map& primary_named_map() const final
+            {
+               for (auto& d : decl_set()) {
+                  auto& m = static_cast<const Named_map&>(d);
+                  if (m.arg(5) != 0)
+                     return m;
+               }
+               unrecorded();
+            }
+            const ipr::Sequence<ipr::Decl>& specializations() const final
+            {
+               return no_decls;
+            }
+            Optional<ipr::Expr> initializer() const final { return body(); }
+            const ipr::Mapping& mapping() const final
+            {
+               return linked<ipr::Mapping>(init_link);
+            }
+            const ipr::Named_map& definition() const final
+            {
+               return static_cast<const ipr::Named_map&>(defining());
+            }
+         };
+
+         // Records: mapping, name, type.
+         struct Parameter : Unique_decl<ipr::Parameter> {
+            using Unique_decl::Unique_decl;
+            const ipr::Parameter_list& membership() const final
+            {
+               return static_cast<const ipr::Parameter_list&>
+                  (rep.region(arg(0)));
+            }
+         };
+
+         // Records: enumeration, name.
+         struct Enumerator : Unique_decl<ipr::Enumerator> {
+            using Unique_decl::Unique_decl;
+            const ipr::Type& type() const final { return membership(); }
+            const ipr::Enum& membership() const final
+            {
+               return get<ipr::Enum>(0);
+            }
+         };
+
+         // Records: class, type, specifiers.  A base type is not a
+         // member of the scope of its class, but of its bases.
+         struct Base_type : Unique_decl<ipr::Base_type> {
+            const Overload singleton;
+
+            Base_type(Rep& r, Word w)
+                  : Unique_decl(r, w), singleton(r, &self, 1) { }
+            ipr::DeclSpecifiers specifiers() const final
+            {
+               return ipr::DeclSpecifiers(arg(2));
+            }
+            const ipr::Name& name() const final { return type().name(); }
+            const ipr::Type& type() const final { return get<ipr::Type>(1); }
+            Optional<ipr::Expr> initializer() const final { return { }; }
+            const ipr::Sequence<ipr::Decl>& decl_set() const final
+            {
+               return singleton;
+            }
+         };
+
+         // Whether N designates the name with index W.
+         bool
+         same_name(Rep& rep, const ipr::Name& n, Word w)
+         {
+            const ipr::Name& m = rep.get<ipr::Name>(w);
+            if (&m == &n)
+               return true;
+            if (n.category != identifier_cat or m.category != identifier_cat)
+               return false;
+            const ipr::String& s = static_cast<const ipr::Identifier&>(n)
+               .string();
+            const ipr::String& t = static_cast<const ipr::Identifier&>(m)
+               .string();
+            return s.size() == t.size()
+               and std::equal(s.begin(), s.end(), t.begin());
+         }
+
+         const ipr::Overload&
+         Scope::operator[](const ipr::Name& n) const
+         {
+            for (int i = 0; i < seq.size(); ++i) {
+               const Word name = rep.record(seq.first[i])[3];
+               if (same_name(rep, n, name))
+                  return rep.overload(self, name);
+            }
+            return rep.overload(self, none);
+         }
+      }
+
+      // -- View::Rep --
+      View::Rep::Rep(const Image& i) : image(i), global_index(builtin_count)
+      {
+         const Word* r = record(global_index);
+         if (r[0] != global_tag)
+            corrupted();
+      }
+
+      const ipr::Node&
+      View::Rep::node(Word w)
+      {
+         const ipr::Node*& p = nodes[w];
+         if (p == nullptr)
+            p = decode(w);
+         return *p;
+      }
+
+      const ipr::String&
+      View::Rep::string(Word w)
+      {
+         if (w >= Word(image.string_count()))
+            corrupted();
+         const ipr::String*& p = strings[w];
+         if (p == nullptr) {
+            const Image::Text t = image.string(w);
+            p = arena.make<Text>(t.first, t.second);
+         }
+         return *p;
+      }
+
+      const ipr::Region&
+      View::Rep::region(Word w)
+      {
+         const ipr::Region*& p = regions[w];
+         if (p == nullptr) {
+            switch (record(w)[0]) {
+            case global_tag: case class_cat: case union_cat:
+            case namespace_cat: case enum_cat: case block_cat:
+               p = arena.make<Region<ipr::Region>>(*this, w);
+               break;
+            case mapping_cat:
+               p = arena.make<Parameter_list>(*this, w);
+               break;
+            default:
+               corrupted();
+            }
+         }
+         return *p;
+      }
+
+      const ipr::Scope&
+      View::Rep::scope(Word w)
+      {
+         const ipr::Scope*& p = scopes[w];
+         if (p == nullptr)
+            p = arena.make<Scope>(*this, w);
+         return *p;
+      }
+
+      std::pair<const Word*, const Word*>
+      View::Rep::scope_members(Word w)
+      {
+         auto m = image.members(w);
+         while (m.first != m.second and record(*m.first)[0] == base_type_cat)
+            ++m.first;
+         return m;
+      }
+
+      const ipr::Name&
+      View::Rep::type_name(Word w)
+      {
+         const ipr::Name*& p = type_names[w];
+         if (p == nullptr)
+            p = arena.make<Made_type_id>(get<ipr::Type>(w));
+         return *p;
+      }
+
+      // The declarations named by the name with index NAME among the
+      // members of W.
+      const ipr::Overload&
+      View::Rep::overload(Word w, Word name)
+      {
+         const ipr::Overload*& p =
+            overloads[std::uint64_t(w) << 32 | name];
+         if (p == nullptr) {
+            auto m = scope_members(w);
+            std::vector<Word> decls;
+            for (const Word* q = m.first; q != m.second; ++q) {
+               const Word* r = record(*q);
+               if (r[1] > 1 and r[3] == name)
+                  decls.push_back(*q);
+            }
+            Word* words = arena.words(decls.size());
+            std::copy(decls.begin(), decls.end(), words);
+            p = arena.make<Overload>(*this, words, int(decls.size()));
+         }
+         return *p;
+      }
+
+      // The declarations of an overload set with a given type.
+      const ipr::Sequence<ipr::Decl>&
+      View::Rep::select(const ipr::Overload& o, const ipr::Type& t)
+      {
+         const ipr::Sequence<ipr::Decl>*& p = selections[{ &o, &t }];
+         if (p == nullptr) {
+            std::vector<Word> decls;
+            auto& seq = static_cast<const Overload&>(o).seq;
+            for (int i = 0; i < seq.size(); ++i)
+               if (&seq[i].type() == &t)
+                  decls.push_back(seq.first[i]);
+            Word* words = arena.words(decls.size());
+            std::copy(decls.begin(), decls.end(), words);
+            p = arena.make<Word_sequence<ipr::Decl>>(*this, words,
+                                                     int(decls.size()));
+         }
+         return *p;
+      }
+
+      const ipr::Linkage&
+      View::Rep::cxx_linkage()
+      {
+         if (cxx == nullptr)
+            cxx = arena.make<Made_linkage>(*arena.make<Text>("C++", 3));
+         return *cxx;
+      }
+
+      const ipr::Expr&
+      View::Rep::phantom()
+      {
+         if (empty == nullptr)
+            empty = arena.make<Made_phantom>();
+         return *empty;
+      }
+
+      const ipr::Identifier&
+      View::Rep::builtin_name(Word i)
+      {
+         if (i >= builtin_count)
+            corrupted();
+         if (builtins[i] == nullptr) {
+            const char* s = builtin_names[i];
+            builtins[i] = arena.make<Made_identifier>
+               (*arena.make<Text>(s, int(std::strlen(s))));
+         }
+         return *builtins[i];
+      }
+
+      const ipr::Global_scope&
+      View::Rep::global()
+      {
+         return get<ipr::Global_scope>(global_index);
+      }
+
+      const ipr::Node*
+      View::Rep::decode(Word w)
+      {
+         const Word* r = record(w);
+         switch (r[0]) {
+         case builtin_tag: return arena.make<Builtin>(*this, w);
+         case global_tag: return arena.make<Global>(*this, w);
+
+         case linkage_cat: return arena.make<Linkage>(*this, w);
+
+         case identifier_cat:
+            return arena.make<Text_name<ipr::Identifier>>(*this, w);
+         case operator_cat:
+            return arena.make<Text_name<ipr::Operator>>(*this, w);
+         case conversion_cat:
+            return arena.make<Type_name<ipr::Conversion>>(*this, w);
+         case ctor_name_cat:
+            return arena.make<Type_name<ipr::Ctor_name>>(*this, w);
+         case dtor_name_cat:
+            return arena.make<Type_name<ipr::Dtor_name>>(*this, w);
+         case type_id_cat:
+            return arena.make<Type_name<ipr::Type_id>>(*this, w);
+         case scope_ref_cat:
+            return arena.make<Binary<ipr::Scope_ref>>(*this, w);
+         case template_id_cat:
+            return arena.make<Binary<ipr::Template_id>>(*this, w);
+
+         case array_cat: return arena.make<Binary_type<ipr::Array>>(*this, w);
+         case as_type_cat:
+            return arena.make<Binary_type<ipr::As_type>>(*this, w);
+         case decltype_cat:
+            return arena.make<Unary_type<ipr::Decltype>>(*this, w);
+         case function_cat: return arena.make<Function>(*this, w);
+         case pointer_cat:
+            return arena.make<Unary_type<ipr::Pointer>>(*this, w);
+         case reference_cat:
+            return arena.make<Unary_type<ipr::Reference>>(*this, w);
+         case rvalue_reference_cat:
+            return arena.make<Unary_type<ipr::Rvalue_reference>>(*this, w);
+         case ptr_to_member_cat:
+            return arena.make<Binary_type<ipr::Ptr_to_member>>(*this, w);
+         case qualified_cat: return arena.make<Qualified>(*this, w);
+         case product_cat:
+            return arena.make<Type_list<ipr::Product>>(*this, w);
+         case sum_cat: return arena.make<Type_list<ipr::Sum>>(*this, w);
+         case template_cat:
+            return arena.make<Binary_type<ipr::Template>>(*this, w);
+         case auto_cat: return arena.make<Auto>(*this, w);
+
+         case class_cat: return arena.make<Class>(*this, w);
+         case union_cat: return arena.make<Udt<ipr::Union>>(*this, w);
+         case namespace_cat:
+            return arena.make<Udt<ipr::Namespace>>(*this, w);
+         case enum_cat: return arena.make<Enum>(*this, w);
+
+         case phantom_cat: return arena.make<Phantom>(*this, w);
+         case literal_cat: return arena.make<Literal>(*this, w);
+         case expr_list_cat: return arena.make<Expr_list>(*this, w);
+         case id_expr_cat: return arena.make<Id_expr>(*this, w);
+         case sizeof_cat: return arena.make<Unary<ipr::Sizeof>>(*this, w);
+         case typeid_cat: return arena.make<Unary<ipr::Typeid>>(*this, w);
+         case member_init_cat:
+            return arena.make<Binary<ipr::Member_init>>(*this, w);
+         case paren_expr_cat: return arena.make<Paren_expr>(*this, w);
+         case conditional_cat: return arena.make<Conditional>(*this, w);
+         case new_cat: return arena.make<New>(*this, w);
+         case mapping_cat: return arena.make<Mapping>(*this, w);
+
+         case address_cat:
+            return arena.make<Classic_unary<ipr::Address>>(*this, w);
+         case array_delete_cat:
+            return arena.make<Classic_unary<ipr::Array_delete>>(*this, w);
+         case complement_cat:
+            return arena.make<Classic_unary<ipr::Complement>>(*this, w);
+         case delete_cat:
+            return arena.make<Classic_unary<ipr::Delete>>(*this, w);
+         case deref_cat:
+            return arena.make<Classic_unary<ipr::Deref>>(*this, w);
+         case initializer_list_cat:
+            return arena.make<Classic_unary<ipr::Initializer_list>>(*this, w);
+         case not_cat: return arena.make<Classic_unary<ipr::Not>>(*this, w);
+         case post_decrement_cat:
+            return arena.make<Classic_unary<ipr::Post_decrement>>(*this, w);
+         case post_increment_cat:
+            return arena.make<Classic_unary<ipr::Post_increment>>(*this, w);
+         case pre_decrement_cat:
+            return arena.make<Classic_unary<ipr::Pre_decrement>>(*this, w);
+         case pre_increment_cat:
+            return arena.make<Classic_unary<ipr::Pre_increment>>(*this, w);
+         case throw_cat:
+            return arena.make<Classic_unary<ipr::Throw>>(*this, w);
+         case unary_minus_cat:
+            return arena.make<Classic_unary<ipr::Unary_minus>>(*this, w);
+         case unary_plus_cat:
+            return arena.make<Classic_unary<ipr::Unary_plus>>(*this, w);
+         case expansion_cat:
+            return arena.make<Classic_unary<ipr::Expansion>>(*this, w);
+
+         case plus_cat:
+            return arena.make<Classic_binary<ipr::Plus>>(*this, w);
+         case plus_assign_cat:
+            return arena.make<Classic_binary<ipr::Plus_assign>>(*this, w);
+         case and_cat: return arena.make<Classic_binary<ipr::And>>(*this, w);
+         case array_ref_cat:
+            return arena.make<Classic_binary<ipr::Array_ref>>(*this, w);
+         case arrow_cat:
+            return arena.make<Classic_binary<ipr::Arrow>>(*this, w);
+         case arrow_star_cat:
+            return arena.make<Classic_binary<ipr::Arrow_star>>(*this, w);
+         case assign_cat:
+            return arena.make<Classic_binary<ipr::Assign>>(*this, w);
+         case bitand_cat:
+            return arena.make<Classic_binary<ipr::Bitand>>(*this, w);
+         case bitand_assign_cat:
+            return arena.make<Classic_binary<ipr::Bitand_assign>>(*this, w);
+         case bitor_cat:
+            return arena.make<Classic_binary<ipr::Bitor>>(*this, w);
+         case bitor_assign_cat:
+            return arena.make<Classic_binary<ipr::Bitor_assign>>(*this, w);
+         case bitxor_cat:
+            return arena.make<Classic_binary<ipr::Bitxor>>(*this, w);
+         case bitxor_assign_cat:
+            return arena.make<Classic_binary<ipr::Bitxor_assign>>(*this, w);
+         case call_cat: return arena.make<Classic_binary<ipr::Call>>(*this, w);
+         case comma_cat:
+            return arena.make<Classic_binary<ipr::Comma>>(*this, w);
+         case div_cat: return arena.make<Classic_binary<ipr::Div>>(*this, w);
+         case div_assign_cat:
+            return arena.make<Classic_binary<ipr::Div_assign>>(*this, w);
+         case dot_cat: return arena.make<Classic_binary<ipr::Dot>>(*this, w);
+         case dot_star_cat:
+            return arena.make<Classic_binary<ipr::Dot_star>>(*this, w);
+         case equal_cat:
+            return arena.make<Classic_binary<ipr::Equal>>(*this, w);
+         case greater_cat:
+            return arena.make<Classic_binary<ipr::Greater>>(*this, w);
+         case greater_equal_cat:
+            return arena.make<Classic_binary<ipr::Greater_equal>>(*this, w);
+         case less_cat: return arena.make<Classic_binary<ipr::Less>>(*this, w);
+         case less_equal_cat:
+            return arena.make<Classic_binary<ipr::Less_equal>>(*this, w);
+         case lshift_cat:
+            return arena.make<Classic_binary<ipr::Lshift>>(*this, w);
+         case lshift_assign_cat:
+            return arena.make<Classic_binary<ipr::Lshift_assign>>(*this, w);
+         case modulo_cat:
+            return arena.make<Classic_binary<ipr::Modulo>>(*this, w);
+         case modulo_assign_cat:
+            return arena.make<Classic_binary<ipr::Modulo_assign>>(*this, w);
+         case mul_cat: return arena.make<Classic_binary<ipr::Mul>>(*this, w);
+         case mul_assign_cat:
+            return arena.make<Classic_binary<ipr::Mul_assign>>(*this, w);
+         case not_equal_cat:
+            return arena.make<Classic_binary<ipr::Not_equal>>(*this, w);
+         case or_cat: return arena.make<Classic_binary<ipr::Or>>(*this, w);
+         case rshift_cat:
+            return arena.make<Classic_binary<ipr::Rshift>>(*this, w);
+         case rshift_assign_cat:
+            return arena.make<Classic_binary<ipr::Rshift_assign>>(*this, w);
+         case minus_cat:
+            return arena.make<Classic_binary<ipr::Minus>>(*this, w);
+         case minus_assign_cat:
+            return arena.make<Classic_binary<ipr::Minus_assign>>(*this, w);
+
+         case cast_cat: return arena.make<Conversion<ipr::Cast>>(*this, w);
+         case const_cast_cat:
+            return arena.make<Conversion<ipr::Const_cast>>(*this, w);
+         case datum_cat: return arena.make<Conversion<ipr::Datum>>(*this, w);
+         case dynamic_cast_cat:
+            return arena.make<Conversion<ipr::Dynamic_cast>>(*this, w);
+         case reinterpret_cast_cat:
+            return arena.make<Conversion<ipr::Reinterpret_cast>>(*this, w);
+         case static_cast_cat:
+            return arena.make<Conversion<ipr::Static_cast>>(*this, w);
+
+         case block_cat: return arena.make<Block>(*this, w);
+         case break_cat: return arena.make<Break>(*this, w);
+         case continue_cat: return arena.make<Continue>(*this, w);
+         case ctor_body_cat: return arena.make<Ctor_body>(*this, w);
+         case do_cat: return arena.make<Binary_stmt<ipr::Do>>(*this, w);
+         case expr_stmt_cat:
+            if (r[1] == 0)
+               return arena.make<Empty_stmt>(*this, w);
+            return arena.make<Unary_stmt<ipr::Expr_stmt>>(*this, w);
+         case for_cat: return arena.make<For>(*this, w);
+         case for_in_cat: return arena.make<For_in>(*this, w);
+         case goto_cat: return arena.make<Unary_stmt<ipr::Goto>>(*this, w);
+         case return_cat:
+            return arena.make<Unary_stmt<ipr::Return>>(*this, w);
+         case handler_cat:
+            return arena.make<Binary_stmt<ipr::Handler>>(*this, w);
+         case if_then_cat:
+            return arena.make<Binary_stmt<ipr::If_then>>(*this, w);
+         case if_then_else_cat: return arena.make<If_then_else>(*this, w);
+         case labeled_stmt_cat:
+            return arena.make<Binary_stmt<ipr::Labeled_stmt>>(*this, w);
+         case switch_cat:
+            return arena.make<Binary_stmt<ipr::Switch>>(*this, w);
+         case while_cat:
+            return arena.make<Binary_stmt<ipr::While>>(*this, w);
+
+         case alias_cat: return arena.make<Alias>(*this, w);
+         case base_type_cat: return arena.make<Base_type>(*this, w);
+         case bitfield_cat: return arena.make<Bitfield>(*this, w);
+         case enumerator_cat: return arena.make<Enumerator>(*this, w);
+         case field_cat: return arena.make<Field>(*this, w);
+         case fundecl_cat: return arena.make<Fundecl>(*this, w);
+         case named_map_cat: return arena.make<Named_map>(*this, w);
+         case parameter_cat: return arena.make<Parameter>(*this, w);
+         case typedecl_cat: return arena.make<Typedecl>(*this, w);
+         case var_cat: return arena.make<Var>(*this, w);
+
+         default:
+            corrupted();
+         }
+      }
+
+      // -- View --
+      View::View(const Image& image) : rep(new Rep(image))
+      { }
+
+      View::~View()
+      { }
+
+      void
+      View::accept(ipr::Translation_unit::Visitor& v) const
+      {
+         v.visit(*this);
+      }
+
+      const ipr::Global_scope&
+      View::global_namespace() const
+      {
+         return rep->global();
+      }
+
+      const ipr::Sequence<ipr::Module>&
+      View::imported_modules() const
+      {
+         return no_modules;
+      }
+
+      const ipr::Node&
+      View::node(int i) const
+      {
+         if (i < 0 or i >= rep->image.node_count())
+            corrupted();
+         return rep->node(i);
+      }
+   }
+}
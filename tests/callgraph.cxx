@@ -0,0 +1,128 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include <ipr/callgraph>
+#include <ipr/image>
+#include "check"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ipr;
+
+namespace {
+   std::vector<std::string>
+   callees(const Call_graph& cg, const std::string& f)
+   {
+      std::map<std::string, int> ids;
+      for (int i = 0; i < cg.size(); ++i) {
+         auto& n = static_cast<const Identifier&>(cg.function(i).name());
+         ids[std::string(n.string().begin(), n.string().end())] = i;
+      }
+      std::vector<std::string> r;
+      auto range = cg.callees(ids.at(f));
+      for (const int* p = range.first; p != range.second; ++p) {
+         auto& n = static_cast<const Identifier&>(cg.function(*p).name());
+         r.emplace_back(n.string().begin(), n.string().end());
+      }
+      return r;
+   }
+}
+
+int
+main()
+{
+   impl::Lexicon lex;
+   impl::Translation_unit unit { lex };
+   impl::Region& g = *unit.global_region();
+   auto& i = lex.int_type();
+   impl::ref_sequence<Type> ps;
+   auto& ft = lex.get_function(lex.get_product(ps), i);
+
+   // int a() { b(); }  int b() { a(); c(); }  int c() { c(); }
+   // int d() { a(); e(); }  int e();
+   std::map<std::string, impl::Fundecl*> fs;
+   std::map<std::string, impl::Block*> bodies;
+   for (const char* n : { "a", "b", "c", "d", "e" }) {
+      impl::Fundecl* f = g.declare_fun(lex.get_identifier(n), ft);
+      fs[n] = f;
+      if (*n == 'e')
+         continue;
+      impl::Mapping* m = lex.make_mapping(g);
+      m->value_type = &i;
+      impl::Block* b = lex.make_block(m->parameters, lex.void_type());
+      m->body = b;
+      f->init = m;
+      bodies[n] = b;
+   }
+   auto call = [&](const char* from, const char* to) {
+      auto& c = *lex.make_call(*lex.make_id_expr(*fs[to]),
+                               *lex.make_expr_list());
+      bodies[from]->add_stmt(lex.make_expr_stmt(c));
+   };
+   call("a", "b");
+   call("b", "a");
+   call("b", "c");
+   call("c", "c");
+   call("d", "a");
+   call("d", "e");
+
+   const Call_graph one { unit };
+   CHECK(one.size() == 5);
+   CHECK(one.edge_count() == 6);
+   CHECK(callees(one, "b") == (std::vector<std::string>{ "a", "c" }));
+   CHECK(callees(one, "e").empty());
+   const int a = one.index(*fs["a"]), b = one.index(*fs["b"]),
+      c = one.index(*fs["c"]), d = one.index(*fs["d"]),
+      e = one.index(*fs["e"]);
+   CHECK(one.component_count() == 4);
+   CHECK(one.component(a) == one.component(b));
+   CHECK(one.component(c) < one.component(a));
+   CHECK(one.component(a) < one.component(d));
+   CHECK(one.component(e) < one.component(d));
+   CHECK(one.recursive(a) and one.recursive(c));
+   CHECK(not one.recursive(d) and not one.recursive(e));
+
+   // Bodies scanned by several threads give the same graph.
+   for (int n : { 2, 4 }) {
+      Call_graph::Options o;
+      o.threads = n;
+      const Call_graph many { unit, o };
+      bool same = many.size() == one.size()
+         and many.edge_count() == one.edge_count();
+      for (int k = 0; same and k < one.size(); ++k) {
+         same = &many.function(k) == &one.function(k)
+            and many.component(k) == one.component(k);
+         auto x = one.callees(k);
+         auto y = many.callees(k);
+         same = same and x.second - x.first == y.second - y.first
+            and std::equal(x.first, x.second, y.first);
+      }
+      CHECK(same);
+   }
+
+   // By default, a view of an image is scanned by one thread, as it
+   // must.
+   std::ostringstream os;
+   image::save(os, lex, unit);
+   const std::string bytes = os.str();
+   std::vector<std::uint64_t> buffer((bytes.size() + 7) / 8);
+   std::memcpy(buffer.data(), bytes.data(), bytes.size());
+   const image::Image img { buffer.data(), bytes.size() };
+   const image::View view { img };
+   const Call_graph viewed { view };
+   CHECK(viewed.size() == one.size());
+   CHECK(viewed.edge_count() == one.edge_count());
+   CHECK(viewed.component_count() == one.component_count());
+   CHECK(callees(viewed, "d") == callees(one, "d"));
+
+   return testing::status();
+}
@@ -0,0 +1,81 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/diff>
+#include <ipr/impl>
+#include "check"
+
+using namespace ipr;
+
+namespace {
+   struct Overload {
+      const ipr::Type* parameter;
+      const char* result;
+   };
+
+   // Declare, in the global scope, one function "f" per overload, each
+   // returning a literal.
+   void
+   declare(impl::Lexicon& lex, impl::Translation_unit& unit,
+           std::initializer_list<Overload> overloads)
+   {
+      impl::Region& g = *unit.global_region();
+      for (auto& o : overloads) {
+         impl::ref_sequence<Type> ps;
+         ps.push_back(o.parameter);
+         auto& ft = lex.get_function(lex.get_product(ps), lex.int_type());
+         impl::Fundecl* f = g.declare_fun(lex.get_identifier("f"), ft);
+         impl::Mapping* m = lex.make_mapping(g);
+         lex.make_parameter(lex.get_identifier("p"), *o.parameter, *m);
+         m->value_type = &lex.int_type();
+         m->body = &lex.get_literal(lex.int_type(), o.result);
+         f->init = m;
+      }
+   }
+
+   int
+   count(const diff::Report& r, diff::Change k)
+   {
+      int n = 0;
+      for (auto& e : r.entries)
+         n += e.kind == k;
+      return n;
+   }
+}
+
+int
+main()
+{
+   impl::Lexicon l1, l2;
+   impl::Translation_unit u1 { l1 }, u2 { l2 };
+   declare(l1, u1, { { &l1.int_type(), "1" },
+                     { &l1.double_type(), "2" },
+                     { &l1.char_type(), "3" } });
+   // Reordered, with one overload inserted in front and one changed.
+   declare(l2, u2, { { &l2.long_type(), "9" },
+                     { &l2.char_type(), "3" },
+                     { &l2.int_type(), "1" },
+                     { &l2.double_type(), "5" } });
+
+   const diff::Report same = diff::compare(u1, u1);
+   CHECK(same.entries.empty());
+   CHECK(same.compared == 3 and same.identical == 3);
+
+   const diff::Report r = diff::compare(u1, u2);
+   CHECK(r.compared == 3);
+   CHECK(r.identical == 2);
+   CHECK(count(r, diff::Change::Added) == 1);
+   CHECK(count(r, diff::Change::Removed) == 0);
+   CHECK(count(r, diff::Change::Changed) == 1);
+   for (auto& e : r.entries)
+      if (e.kind == diff::Change::Changed) {
+         CHECK(e.name == "f");
+         CHECK(&e.before->type() == &u1.global_namespace().members()[1].type());
+         CHECK(&e.after->type() == &u2.global_namespace().members()[3].type());
+      }
+
+   return testing::status();
+}
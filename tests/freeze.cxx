@@ -0,0 +1,125 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include <ipr/io>
+#include "check"
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace ipr;
+
+namespace {
+   std::string
+   print(const ipr::Translation_unit& unit)
+   {
+      std::ostringstream os;
+      Printer pp { os };
+      pp << unit;
+      return os.str();
+   }
+
+   // The declarations found for each name, by name and by type.
+   std::vector<const Decl*>
+   lookups(const Scope& s, const std::vector<const Name*>& names)
+   {
+      std::vector<const Decl*> r;
+      for (const Name* n : names) {
+         const Overload& o = s[*n];
+         r.push_back(nullptr);
+         for (const Decl& d : o) {
+            r.push_back(&d);
+            for (const Decl& x : o[d.type()])
+               r.push_back(&x);
+         }
+      }
+      return r;
+   }
+
+   template<class F>
+   bool
+   rejected(F f)
+   {
+      try {
+         f();
+      }
+      catch (const std::logic_error&) {
+         return true;
+      }
+      return false;
+   }
+}
+
+int
+main()
+{
+   impl::Lexicon lex;
+   impl::Translation_unit unit { lex };
+   impl::Region& g = *unit.global_region();
+   auto& i = lex.int_type();
+
+   // int f(int);  int f(int*);  int f(int);  int v;  struct C { int x; };
+   std::vector<const Name*> names;
+   for (const char* n : { "f", "v", "C", "x", "none" })
+      names.push_back(&lex.get_identifier(n));
+   impl::ref_sequence<Type> ps;
+   ps.push_back(&i);
+   auto& f1 = lex.get_function(lex.get_product(ps), i);
+   impl::ref_sequence<Type> qs;
+   qs.push_back(&lex.get_pointer(i));
+   auto& f2 = lex.get_function(lex.get_product(qs), i);
+   auto fun = [&](const Name& n, const Function& t) {
+      impl::Mapping* m = lex.make_mapping(g);
+      m->value_type = &i;
+      m->body = &lex.get_literal(i, "0");
+      impl::Fundecl* d = g.declare_fun(n, t);
+      d->init = m;
+      return d;
+   };
+   impl::Fundecl* f = fun(*names[0], f1);
+   fun(*names[0], f2);
+   fun(*names[0], f1);
+   g.declare_var(*names[1], i);
+   impl::Class* c = lex.make_class(g);
+   c->id = names[2];
+   g.declare_type(*names[2], lex.class_type())->init = c;
+   c->declare_field(*names[3], i);
+   impl::Mapping* m = fun(lex.get_identifier("h"), f1)->init;
+   impl::Block* b = lex.make_block(m->parameters, lex.void_type());
+   m->body = b;
+   impl::Expr_list* l = lex.make_expr_list();
+   l->push_back(&lex.get_literal(i, "1"));
+   b->add_stmt(lex.make_expr_stmt(lex.get_literal(i, "2")));
+   b->add_stmt(lex.make_expr_stmt(*lex.make_call
+                                  (*lex.make_id_expr(*f), *l)));
+
+   const std::vector<const Decl*> global = lookups(g.scope, names);
+   const std::vector<const Decl*> inner = lookups(c->scope(), names);
+   const std::string before = print(unit);
+
+   lex.freeze(unit);
+   CHECK(lex.frozen());
+
+   // Lookups find the same declarations, in the same order.
+   CHECK(lookups(g.scope, names) == global);
+   CHECK(lookups(c->scope(), names) == inner);
+   CHECK(print(unit) == before);
+
+   // Scopes and sequences of the unit no longer change.
+   CHECK(rejected([&] { g.declare_var(lex.get_identifier("w"), i); }));
+   CHECK(rejected([&] { c->declare_field(lex.get_identifier("y"), i); }));
+   CHECK(rejected([&] { l->push_back(&lex.get_literal(i, "3")); }));
+   CHECK(rejected([&] {
+            b->add_stmt(lex.make_expr_stmt(lex.get_literal(i, "4")));
+         }));
+   CHECK(l->operand().size() == 1);
+   CHECK(b->body().size() == 2);
+   CHECK(print(unit) == before);
+
+   return testing::status();
+}
@@ -0,0 +1,164 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include <ipr/image>
+#include <ipr/diff>
+#include <ipr/io>
+#include "check"
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace ipr;
+
+namespace {
+   std::string
+   print(const Translation_unit& unit)
+   {
+      std::ostringstream os;
+      Printer pp { os };
+      pp << unit;
+      return os.str();
+   }
+
+   // Image bytes, held at the alignment an Image reads them with.
+   struct Buffer {
+      explicit Buffer(const std::string& s)
+            : words((s.size() + 7) / 8), size(s.size())
+      {
+         std::memcpy(words.data(), s.data(), s.size());
+      }
+
+      char* data() { return reinterpret_cast<char*>(words.data()); }
+
+      std::vector<std::uint64_t> words;
+      std::size_t size;
+   };
+
+   template<class F>
+   bool
+   rejected(F f)
+   {
+      try {
+         f();
+      }
+      catch (const std::domain_error&) {
+         return true;
+      }
+      return false;
+   }
+
+   // namespace N { struct C { int x; }; int v = 2; }
+   // int g(int p, int* q)
+   // {
+   //    int t = p - -1;
+   //    if (t < 3) return g(-t, *q); else t = t - 1;
+   //    return !!t;
+   // }
+   void
+   build(impl::Lexicon& lex, impl::Translation_unit& unit)
+   {
+      impl::Region& gr = *unit.global_region();
+      const Type& i = lex.int_type();
+      const Type& p = lex.get_pointer(i);
+      impl::Namespace* ns = lex.make_namespace(gr);
+      ns->id = &lex.get_identifier("N");
+      gr.declare_type(*ns->id, lex.namespace_type())->init = ns;
+      impl::Class* c = lex.make_class(ns->body);
+      c->id = &lex.get_identifier("C");
+      ns->declare_type(*c->id, lex.class_type())->init = c;
+      c->declare_field(lex.get_identifier("x"), i);
+      ns->declare_var(lex.get_identifier("v"), i)->init =
+         &lex.get_literal(i, "2");
+
+      impl::ref_sequence<Type> qs;
+      qs.push_back(&i);
+      qs.push_back(&p);
+      auto& ft = lex.get_function(lex.get_product(qs), i);
+      impl::Fundecl* g = gr.declare_fun(lex.get_identifier("g"), ft);
+      impl::Mapping* m = lex.make_mapping(gr);
+      auto* pv = lex.make_parameter(lex.get_identifier("p"), i, *m);
+      auto* qv = lex.make_parameter(lex.get_identifier("q"), p, *m);
+      m->value_type = &i;
+      impl::Block* b = lex.make_block(m->parameters, lex.void_type());
+      m->body = b;
+      g->init = m;
+      auto* t = b->region.declare_var(lex.get_identifier("t"), i);
+      t->init = lex.make_minus(*lex.make_id_expr(*pv),
+                               *lex.make_unary_minus(lex.get_literal(i, "1")));
+      b->add_stmt(t);
+      impl::Expr_list* args = lex.make_expr_list();
+      args->push_back(lex.make_unary_minus(*lex.make_id_expr(*t)));
+      args->push_back(lex.make_deref(*lex.make_id_expr(*qv)));
+      b->add_stmt(lex.make_if_then_else
+                  (*lex.make_less(*lex.make_id_expr(*t),
+                                  lex.get_literal(i, "3")),
+                   *lex.make_return(*lex.make_call(*lex.make_id_expr(*g),
+                                                   *args)),
+                   *lex.make_expr_stmt
+                   (*lex.make_assign(*lex.make_id_expr(*t),
+                                     *lex.make_minus(*lex.make_id_expr(*t),
+                                                     lex.get_literal(i, "1"))))));
+      b->add_stmt(lex.make_return
+                  (*lex.make_not(*lex.make_not(*lex.make_id_expr(*t)))));
+   }
+}
+
+int
+main()
+{
+   impl::Lexicon lex;
+   impl::Translation_unit unit { lex };
+   build(lex, unit);
+   const std::string text = print(unit);
+   CHECK(text.find("return") != std::string::npos);
+
+   std::ostringstream os;
+   image::save(os, lex, unit);
+   const std::string bytes = os.str();
+
+   // A restored image prints as its source.
+   Buffer buffer { bytes };
+   const image::Image img { buffer.data(), buffer.size };
+   impl::Lexicon lex2;
+   impl::Translation_unit back { lex2 };
+   CHECK(image::restore(img, lex2, back) == img.node_count());
+   CHECK(print(back) == text);
+   CHECK(diff::compare(unit, back).entries.empty());
+
+   // So does a view of the image, and a compacted copy of the unit.
+   const image::View view { img };
+   CHECK(print(view) == text);
+   CHECK(diff::compare(unit, view).entries.empty());
+   impl::Lexicon lex3;
+   impl::Translation_unit copy { lex3 };
+   CHECK(image::compact(lex, unit, lex3, copy) == img.node_count());
+   CHECK(print(copy) == text);
+   CHECK(diff::compare(unit, copy).entries.empty());
+
+   // Truncated and foreign images are rejected.
+   for (std::size_t n : { std::size_t(0), sizeof(image::Header) - 1,
+                          sizeof(image::Header), bytes.size() / 2,
+                          bytes.size() - 4 }) {
+      Buffer part { bytes.substr(0, n) };
+      CHECK(rejected([&] { image::Image(part.data(), part.size); }));
+   }
+   Buffer bad { bytes };
+   bad.data()[0] ^= 1;
+   CHECK(rejected([&] { image::Image(bad.data(), bad.size); }));
+   image::Header h;
+   Buffer old { bytes };
+   std::memcpy(&h, old.data(), sizeof h);
+   h.version += 1;
+   std::memcpy(old.data(), &h, sizeof h);
+   CHECK(rejected([&] { image::Image(old.data(), old.size); }));
+
+   return testing::status();
+}
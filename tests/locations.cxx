@@ -0,0 +1,117 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include <ipr/locations>
+#include "check"
+#include <string>
+#include <vector>
+
+using namespace ipr;
+
+namespace {
+   Basic_location
+   at(int line, int column)
+   {
+      Basic_location x;
+      x.line = Line_number(line);
+      x.column = Column_number(column);
+      return x;
+   }
+
+   void
+   locate(impl::Stmt_common& s, int file, int line, int column)
+   {
+      s.src_locus.file = File_index(file);
+      s.src_locus.line = Line_number(line);
+      s.src_locus.column = Column_number(column);
+   }
+}
+
+int
+main()
+{
+   impl::Lexicon lex;
+   impl::Translation_unit unit { lex };
+   impl::Region& g = *unit.global_region();
+   auto& i = lex.int_type();
+   impl::ref_sequence<Type> ps;
+   ps.push_back(&i);
+   auto& ft = lex.get_function(lex.get_product(ps), i);
+
+   // Functions of two files, each on its line followed by a body of
+   // statements on lines of their own, indented by 4, and a blank line.
+   const int fs = 60, ss = 5;
+   auto line = [](int f) { return (f / 2) * (ss + 2) + 1; };
+   std::vector<const Stmt*> decls;
+   std::vector<std::vector<impl::Expr_stmt*>> bodies(fs);
+   for (int f = 0; f < fs; ++f) {
+      impl::Fundecl* d = g.declare_fun
+         (lex.get_identifier("f" + std::to_string(f)), ft);
+      locate(*d, f % 2, line(f), 1);
+      impl::Mapping* m = lex.make_mapping(g);
+      const impl::Parameter* p =
+         lex.make_parameter(lex.get_identifier("p"), i, *m);
+      m->value_type = &i;
+      impl::Block* b = lex.make_block(m->parameters, lex.void_type());
+      m->body = b;
+      d->init = m;
+      decls.push_back(d);
+      for (int k = 0; k < ss; ++k) {
+         impl::Expr_stmt* s = lex.make_expr_stmt(*lex.make_id_expr(*p));
+         locate(*s, f % 2, line(f) + 1 + k, 4);
+         b->add_stmt(s);
+         bodies[f].push_back(s);
+      }
+   }
+
+   Location_index x { unit };
+   CHECK(x.size() == fs * (ss + 1));
+   int wrong = 0;
+   for (int f = 0; f < fs; ++f) {
+      const File_index file = File_index(f % 2);
+      const int l = line(f);
+      wrong += x.at(file, at(l, 1)) != decls[f];
+      wrong += x.at(file, at(l, 80)) != decls[f];
+      wrong += x.at(file, at(l + 3, 4)) != bodies[f][2];
+      wrong += x.at(file, at(l + 3, 2)) != decls[f];
+      wrong += x.at(file, at(l + ss + 1, 1)) != nullptr;
+      auto r = x.in(file, at(l + 2, 1), at(l + 4, 80));
+      wrong += r.size() != 4 or r[0].stmt != decls[f]
+         or r[1].stmt != bodies[f][1] or r[3].stmt != bodies[f][3];
+   }
+   CHECK(wrong == 0);
+   CHECK(x.at(File_index(2), at(1, 1)) == nullptr);
+
+   // Statements erased, then put back elsewhere on their line, more
+   // times than the index folds in its changes.
+   wrong = 0;
+   for (int n = 0; n < 4 * fs * ss; ++n) {
+      const int f = n * 7 % fs;
+      const int k = n % ss;
+      impl::Expr_stmt* s = bodies[f][k];
+      const File_index file = File_index(f % 2);
+      const int l = line(f) + 1 + k;
+      wrong += not x.erase(*s);
+      wrong += x.erase(*s);
+      wrong += x.at(file, at(l, 4)) != decls[f];
+      const int column = n % 2 == 0 ? 6 : 4;
+      locate(*s, f % 2, l, column);
+      x.insert(*s, at(l, column + 3));
+      wrong += x.at(file, at(l, column + 2)) != s;
+      wrong += x.at(file, at(l, column + 4)) == s;
+   }
+   CHECK(wrong == 0);
+   CHECK(x.size() == fs * (ss + 1));
+
+   // Inserting a statement again moves it.
+   impl::Expr_stmt* s = bodies[0][0];
+   x.insert(*s, at(line(0) + 1, 100));
+   CHECK(x.size() == fs * (ss + 1));
+   CHECK(x.at(File_index(0), at(line(0) + 1, 90)) == s);
+
+   return testing::status();
+}
@@ -0,0 +1,47 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include "check"
+
+using namespace ipr;
+
+int
+main()
+{
+   impl::Lexicon lex;
+   impl::Translation_unit unit { lex };
+   impl::Region& g = *unit.global_region();
+   const Type& i = lex.int_type();
+   const Name& f = lex.get_identifier("f");
+   impl::ref_sequence<Type> ps;
+   ps.push_back(&i);
+   const Function& ft = lex.get_function(lex.get_product(ps), i);
+
+   // int f(int);  int v;  int f(int);
+   impl::Fundecl* first = g.declare_fun(f, ft);
+   g.declare_var(lex.get_identifier("v"), i);
+   impl::Fundecl* second = g.declare_fun(f, ft);
+
+   // The redeclaration joins the overload set and decl-set of the
+   // first declaration, which is the master of both.
+   const Overload& o = g.scope[f];
+   int types = 0, decls = 0;
+   for (const Decl& d : o) {
+      ++types;
+      for (const Decl& x : o[d.type()]) {
+         (void)x;
+         ++decls;
+      }
+   }
+   CHECK(types == 1);
+   CHECK(decls == 2);
+   CHECK(&second->master() == &first->master());
+   CHECK(&first->master() == &*o[ft].begin());
+   CHECK(&g.scope[lex.get_identifier("v")] != &o);
+
+   return testing::status();
+}
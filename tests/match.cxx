@@ -0,0 +1,70 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include <ipr/match>
+#include "check"
+#include <vector>
+
+using namespace ipr;
+
+int
+main()
+{
+   impl::Lexicon lex;
+   impl::Translation_unit unit { lex };
+   impl::Region& g = *unit.global_region();
+   auto& i = lex.int_type();
+   impl::ref_sequence<Type> ps;
+   auto& ft = lex.get_function(lex.get_product(ps), i);
+
+   // int free() { }  int f() { free(); f(); free(); }
+   impl::Block* b = nullptr;
+   auto fun = [&](const char* n) {
+      impl::Fundecl* d = g.declare_fun(lex.get_identifier(n), ft);
+      impl::Mapping* m = lex.make_mapping(g);
+      m->value_type = &i;
+      b = lex.make_block(m->parameters, lex.void_type());
+      m->body = b;
+      d->init = m;
+      return d;
+   };
+   impl::Fundecl* fr = fun("free");
+   impl::Fundecl* f = fun("f");
+   for (impl::Fundecl* d : { fr, f, fr })
+      b->add_stmt(lex.make_expr_stmt
+                  (*lex.make_call(*lex.make_id_expr(*d),
+                                  *lex.make_expr_list())));
+
+   using namespace match;
+   const Pattern calls_free =
+      of(call_cat) and operand(0, of(id_expr_cat)
+                                  and resolves(of(fundecl_cat)
+                                               and named("free")));
+   std::vector<const Node*> found;
+   Engine e;
+   CHECK(e.add("free", calls_free,
+               [&](const Node& n) { found.push_back(&n); }) == 0);
+   CHECK(e.add("call", of(call_cat), nullptr) == 1);
+   e.run(unit);
+   CHECK(found.size() == 2);
+   CHECK(e.counters()[0].hits == 2);
+   CHECK(e.counters()[1].hits == 3);
+   // Only calls are tested against patterns rooted at calls.
+   CHECK(e.counters()[0].tests == 3);
+
+   // Patterns are not timed unless asked.
+   CHECK(e.counters()[0].seconds == 0);
+   Options o;
+   o.timing = true;
+   Engine timed { o };
+   timed.add("free", calls_free, nullptr);
+   timed.run(unit);
+   CHECK(timed.counters()[0].hits == 2);
+   CHECK(timed.counters()[0].seconds >= 0);
+
+   return testing::status();
+}
@@ -0,0 +1,104 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include <ipr/image>
+#include "check"
+#include <string>
+#include <vector>
+
+using namespace ipr;
+
+namespace {
+   // namespace N { struct C { T x; }; int <v>; }
+   struct Part {
+      impl::Lexicon lex;
+      impl::Translation_unit unit { lex };
+
+      Part(const char* v, bool differs)
+      {
+         impl::Region& g = *unit.global_region();
+         const Type& i = lex.int_type();
+         impl::Namespace* ns = lex.make_namespace(g);
+         ns->id = &lex.get_identifier("N");
+         g.declare_type(*ns->id, lex.namespace_type())->init = ns;
+         impl::Class* c = lex.make_class(ns->body);
+         c->id = &lex.get_identifier("C");
+         ns->declare_type(*c->id, lex.class_type())->init = c;
+         c->declare_field(lex.get_identifier("x"),
+                          differs ? lex.double_type() : i);
+         ns->declare_var(lex.get_identifier(v), i);
+      }
+   };
+
+   // The declarations of a name in a scope, redeclarations included.
+   int
+   count(const Scope& s, const Name& n)
+   {
+      int k = 0;
+      const Overload& o = s[n];
+      for (const Decl& d : o)
+         for (const Decl& x : o[d.type()]) {
+            (void)x;
+            ++k;
+         }
+      return k;
+   }
+
+   const Scope&
+   members(const Scope& s, const Name& n)
+   {
+      const Decl& d = *s[n].begin();
+      return static_cast<const Udt&>(d.initializer().get()).scope();
+   }
+}
+
+int
+main()
+{
+   for (int n : { 1, 2 }) {
+      image::Merge_options o;
+      o.partitions = n;
+
+      // Units that share N::C merge into one N with one C.
+      Part a { "a", false }, b { "b", false };
+      impl::Lexicon lex;
+      impl::Translation_unit unit { lex };
+      image::Merge_report r =
+         image::merge({ { a.lex, a.unit }, { b.lex, b.unit } }, lex, unit, o);
+      CHECK(r.units == 2);
+      CHECK(r.namespaces == 1);
+      CHECK(r.types == 1);
+      CHECK(r.conflicts.empty());
+      const Scope& g = unit.global_namespace().scope();
+      const Name& N = lex.get_identifier("N");
+      const Name& C = lex.get_identifier("C");
+      CHECK(count(g, N) == 1);
+      const Scope& ns = members(g, N);
+      CHECK(count(ns, C) == 1);
+      CHECK(count(ns, lex.get_identifier("a")) == 1);
+      CHECK(count(ns, lex.get_identifier("b")) == 1);
+      CHECK(count(members(ns, C), lex.get_identifier("x")) == 1);
+
+      // A definition of N::C that differs is kept apart, as a conflict.
+      Part c { "c", true };
+      impl::Lexicon lex2;
+      impl::Translation_unit unit2 { lex2 };
+      r = image::merge({ { a.lex, a.unit }, { c.lex, c.unit } },
+                       lex2, unit2, o);
+      CHECK(r.namespaces == 1);
+      CHECK(r.types == 0);
+      CHECK(r.conflicts.size() == 1);
+      const Scope& ns2 = members(unit2.global_namespace().scope(),
+                                 lex2.get_identifier("N"));
+      CHECK(count(ns2, lex2.get_identifier("C")) == 2);
+      CHECK(r.conflicts.size() == 1
+            and r.conflicts[0].first != r.conflicts[0].second
+            and &r.conflicts[0].first->name() == &lex2.get_identifier("C"));
+   }
+
+   return testing::status();
+}
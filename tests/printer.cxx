@@ -0,0 +1,173 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include <ipr/io>
+#include "check"
+#include <cctype>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ipr;
+
+namespace {
+   struct Item {
+      Printer::Padding pad;
+      const Type* type;
+   };
+
+   void
+   print(Printer& pp, const Item& x)
+   {
+      pp << x.pad << xpr_type(*x.type) << Printer::None << "|";
+   }
+
+   // The text of an item, printed on its own.
+   std::string
+   alone(const Item& x)
+   {
+      std::ostringstream os;
+      Printer pp { os };
+      print(pp, x);
+      return os.str();
+   }
+
+   // The tokens of a text: string literals, runs of word characters,
+   // runs of operator characters, and single brackets and separators.
+   std::vector<std::string>
+   tokens(const std::string& s)
+   {
+      auto kind = [](char c) {
+         if (std::isalnum(static_cast<unsigned char>(c)) or c == '_'
+             or c == '#')
+            return 1;
+         if (std::isspace(static_cast<unsigned char>(c)))
+            return 0;
+         return std::strchr("()[]{},;", c) != nullptr ? 3 : 2;
+      };
+      std::vector<std::string> v;
+      for (std::size_t i = 0; i < s.size(); ) {
+         std::size_t j = i + 1;
+         const int k = kind(s[i]);
+         if (s[i] == '"') {
+            while (j < s.size() and s[j] != '"')
+               ++j;
+            ++j;
+         }
+         else if (k == 0) {
+            i = j;
+            continue;
+         }
+         else if (k != 3)
+            while (j < s.size() and kind(s[j]) == k and s[j] != '"')
+               ++j;
+         v.push_back(s.substr(i, j - i));
+         i = j;
+      }
+      return v;
+   }
+
+   std::string
+   print(const Translation_unit& unit, Printer::Layout l)
+   {
+      std::ostringstream os;
+      Printer pp { os, l };
+      pp << unit;
+      return os.str();
+   }
+}
+
+int
+main()
+{
+   impl::Lexicon lex;
+   const Type& i = lex.int_type();
+   const Type& p = lex.get_pointer(i);
+   const Type& c = lex.get_qualified(Type_qualifier::Const, p);
+   impl::ref_sequence<Type> ps;
+   ps.push_back(&c);
+   ps.push_back(&lex.get_reference(i));
+   const Type& f = lex.get_function(lex.get_product(ps), p);
+   const Type& a = lex.get_array(lex.get_pointer(f),
+                                 lex.get_literal(i, "4"));
+   const std::vector<const Type*> types { &i, &p, &c, &f, &a };
+
+   // Types printed again, as parts of others or not, after either
+   // padding, read as when printed the first time.
+   std::vector<Item> items;
+   for (int k = 0; k < 3; ++k)
+      for (const Type* t : types) {
+         items.push_back({ Printer::None, t });
+         items.push_back({ Printer::Before, t });
+      }
+   std::string expected;
+   for (const Item& x : items)
+      expected += alone(x);
+   std::ostringstream os;
+   Printer pp { os };
+   for (const Item& x : items)
+      print(pp, x);
+   CHECK(os.str() == expected);
+
+   // int g(int p, int* q)
+   // {
+   //    int t = p - -1;
+   //    const char* s = "a b  c";
+   //    if (t < 0x1e) return g(-t, *q); else t = t - 1;
+   //    return !!t;
+   // }
+   impl::Translation_unit unit { lex };
+   impl::Region& gr = *unit.global_region();
+   impl::ref_sequence<Type> qs;
+   qs.push_back(&i);
+   qs.push_back(&p);
+   auto& ft = lex.get_function(lex.get_product(qs), i);
+   impl::Fundecl* g = gr.declare_fun(lex.get_identifier("g"), ft);
+   impl::Mapping* m = lex.make_mapping(gr);
+   auto* pv = lex.make_parameter(lex.get_identifier("p"), i, *m);
+   auto* qv = lex.make_parameter(lex.get_identifier("q"), p, *m);
+   m->value_type = &i;
+   impl::Block* b = lex.make_block(m->parameters, lex.void_type());
+   m->body = b;
+   g->init = m;
+   auto* t = b->region.declare_var(lex.get_identifier("t"), i);
+   t->init = lex.make_minus(*lex.make_id_expr(*pv),
+                            *lex.make_unary_minus(lex.get_literal(i, "1")));
+   b->add_stmt(t);
+   const Type& cs = lex.get_pointer(lex.get_qualified(Type_qualifier::Const,
+                                                      lex.char_type()));
+   auto* s = b->region.declare_var(lex.get_identifier("s"), cs);
+   s->init = &lex.get_literal(cs, "\"a b  c\"");
+   b->add_stmt(s);
+   impl::Expr_list* args = lex.make_expr_list();
+   args->push_back(lex.make_unary_minus(*lex.make_id_expr(*t)));
+   args->push_back(lex.make_deref(*lex.make_id_expr(*qv)));
+   b->add_stmt(lex.make_if_then_else
+               (*lex.make_less(*lex.make_id_expr(*t),
+                               lex.get_literal(i, "0x1e")),
+                *lex.make_return(*lex.make_call(*lex.make_id_expr(*g), *args)),
+                *lex.make_expr_stmt
+                (*lex.make_assign(*lex.make_id_expr(*t),
+                                  *lex.make_minus(*lex.make_id_expr(*t),
+                                                  lex.get_literal(i, "1"))))));
+   b->add_stmt(lex.make_return
+               (*lex.make_not(*lex.make_not(*lex.make_id_expr(*t)))));
+
+   // Compact output has the tokens of pretty output, on one line, and
+   // spaces only where tokens would otherwise run together.
+   const std::string pretty = print(unit, Printer::Pretty);
+   const std::string compact = print(unit, Printer::Compact);
+   CHECK(tokens(compact) == tokens(pretty));
+   CHECK(compact.size() < pretty.size());
+   CHECK(compact.find('\n') == std::string::npos);
+   CHECK(compact.find("- -1") != std::string::npos);
+   CHECK(compact.find("\"a b  c\"") != std::string::npos);
+   CHECK(compact.find("if(t<0x1e)return g(-t,*q);") != std::string::npos);
+
+   return testing::status();
+}
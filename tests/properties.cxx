@@ -0,0 +1,69 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include <ipr/property>
+#include "check"
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace ipr;
+
+int
+main()
+{
+   impl::Lexicon lex;
+   std::vector<const Node*> ids;
+   for (int i = 0; i < 3000; ++i)
+      ids.push_back(&lex.get_identifier("x" + std::to_string(i)));
+
+   // Nodes never written read as the default value, before and after
+   // a clear.
+   Node_map<int> m { -1 };
+   for (int i = 0; i < 3000; i += 2)
+      m[*ids[i]] = i;
+   bool ok = true;
+   for (int i = 0; i < 3000; ++i)
+      ok = ok and m(*ids[i]) == (i % 2 == 0 ? i : -1);
+   CHECK(ok);
+   const std::size_t held = m.memory();
+   m.clear();
+   ok = true;
+   for (int i = 0; i < 3000; ++i)
+      ok = ok and m(*ids[i]) == -1;
+   CHECK(ok);
+   CHECK(m.memory() == held);
+
+   // A set counts its members once.
+   Node_set s;
+   CHECK(s.insert(*ids[5]));
+   CHECK(not s.insert(*ids[5]));
+   CHECK(s.insert(*ids[2999]));
+   CHECK(s.contains(*ids[5]) and not s.contains(*ids[6]));
+   CHECK(s.size() == 2);
+   CHECK(s.erase(*ids[5]) and not s.erase(*ids[5]));
+   s.clear();
+   CHECK(s.empty() and not s.contains(*ids[2999]));
+
+   // A Lexicon gives the same property for a key, of one type only.
+   static const char key = 0;
+   Node_set& p = lex.property<Node_set>(&key);
+   p.insert(*ids[0]);
+   CHECK(&lex.property<Node_set>(&key) == &p);
+   bool thrown = false;
+   try {
+      lex.property<Node_map<int>>(&key);
+   }
+   catch (const std::logic_error&) {
+      thrown = true;
+   }
+   CHECK(thrown);
+   lex.drop_property(&key);
+   CHECK(not lex.property<Node_set>(&key).contains(*ids[0]));
+
+   return testing::status();
+}
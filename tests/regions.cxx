@@ -0,0 +1,120 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include "check"
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace ipr;
+
+namespace {
+   // The regions made, with those enclosing them.
+   struct Tree {
+      std::unordered_map<const Region*, const Region*> up;
+      std::vector<const Region*> all;
+
+      template<typename R>
+      R*
+      add(R* r, const Region* p)
+      {
+         up[r] = p;
+         all.push_back(r);
+         return r;
+      }
+
+      int
+      depth(const Region* r)
+      {
+         int d = -1;
+         for (; r != nullptr; r = up[r])
+            ++d;
+         return d;
+      }
+
+      bool
+      encloses(const Region* o, const Region* i)
+      {
+         for (; i != nullptr; i = up[i])
+            if (i == o)
+               return true;
+         return false;
+      }
+   };
+}
+
+int
+main()
+{
+   impl::Lexicon lex;
+   impl::Translation_unit unit { lex };
+   impl::Region& g = *unit.global_region();
+   Tree t;
+   t.add(&g, nullptr);
+
+   // Nested classes, then regions added as they are made: a deep
+   // chain, and a fan of siblings off the middle of it.
+   std::vector<impl::Region*> chain { &g };
+   for (int i = 0; i < 20; ++i) {
+      impl::Class* c = lex.make_class(*chain.back());
+      auto& id = lex.get_identifier("c" + std::to_string(i));
+      c->id = &id;
+      chain.back()->declare_type(id, lex.class_type())->init = c;
+      t.add(&c->base_subobjects, chain.back());
+      chain.push_back(t.add(&c->body, chain.back()));
+   }
+   impl::Region_index ix;
+   ix.build(unit);
+   CHECK(ix.size() == int(t.all.size()));
+
+   for (int i = 0; i < 2000; ++i)
+      chain.push_back(t.add(chain.back()->make_subregion(ix), chain.back()));
+   impl::Region* mid = chain[chain.size() / 2];
+   for (int i = 0; i < 500; ++i)
+      t.add(mid->make_subregion(ix), mid);
+   CHECK(ix.size() == int(t.all.size()));
+
+   // Every ancestor of every region, against the enclosing regions.
+   int wrong = 0;
+   for (const Region* r : t.all) {
+      const int d = ix.depth(*r);
+      if (d != t.depth(r))
+         ++wrong;
+      const Region* a = r;
+      for (int k = d; k >= 0; --k, a = t.up[a])
+         if (&ix.ancestor(*r, k) != a)
+            ++wrong;
+   }
+   CHECK(wrong == 0);
+
+   // Nesting and order, on a sample of pairs.
+   wrong = 0;
+   const std::size_t n = t.all.size();
+   for (std::size_t i = 0; i < n; i += 7)
+      for (std::size_t j = 0; j < n; j += 11) {
+         const Region* x = t.all[i];
+         const Region* y = t.all[j];
+         const bool in = t.encloses(x, y);
+         if (ix.contains(*x, *y) != in)
+            ++wrong;
+         if (in and x != y and not ix.precedes(*x, *y))
+            ++wrong;
+      }
+   CHECK(wrong == 0);
+
+   bool thrown = false;
+   try {
+      ix.ancestor(*chain.back(), ix.depth(*chain.back()) + 1);
+   }
+   catch (const std::domain_error&) {
+      thrown = true;
+   }
+   CHECK(thrown);
+
+   return testing::status();
+}
@@ -0,0 +1,104 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include "check"
+#include <vector>
+
+using namespace ipr;
+
+namespace {
+   // Declare a function with a body in the global scope of a unit, and
+   // return the node_ids of some of the nodes made.
+   std::vector<int>
+   populate(impl::Lexicon& lex, impl::Translation_unit& unit, const char* n)
+   {
+      impl::Region& g = *unit.global_region();
+      impl::ref_sequence<Type> ps;
+      auto& ft = lex.get_function(lex.get_product(ps), lex.int_type());
+      impl::Fundecl* f = g.declare_fun(lex.get_identifier(n), ft);
+      impl::Mapping* m = lex.make_mapping(g);
+      m->value_type = &lex.int_type();
+      m->body = &lex.get_literal(lex.int_type(), n);
+      f->init = m;
+      return { f->node_id, m->node_id, m->body->node_id,
+               lex.get_identifier(n).node_id,
+               unit.global_namespace().node_id };
+   }
+
+   bool
+   listed(const Node_registry& r, int id)
+   {
+      for (int c = 0; c < last_code_cat; ++c)
+         for (auto& n : r.nodes(Category_code(c)))
+            if (n.node_id == id)
+               return true;
+      return false;
+   }
+}
+
+int
+main()
+{
+   impl::Lexicon earlier;
+   impl::Lexicon lex { impl::Lexicon::categorized };
+   impl::Translation_unit unit { lex };
+   const Node_registry& r = *lex.registry();
+
+   const std::vector<int> first = populate(lex, unit, "f");
+   for (int id : first) {
+      CHECK(r.find(id) != nullptr and r.find(id)->node_id == id);
+      CHECK(listed(r, id));
+   }
+
+   // Nodes of other Lexicons on the same thread, made before or after
+   // the registered one, are not recorded; nodes of the registered
+   // one made meanwhile are.
+   std::vector<int> foreign;
+   std::vector<int> own;
+   {
+      impl::Lexicon later;
+      impl::Translation_unit u1 { earlier }, u2 { later };
+      foreign = populate(earlier, u1, "g");
+      own = populate(lex, unit, "h");
+      for (int id : populate(later, u2, "k"))
+         foreign.push_back(id);
+   }
+   for (int id : foreign) {
+      CHECK(r.find(id) == nullptr);
+      CHECK(not listed(r, id));
+   }
+   for (int id : own) {
+      CHECK(r.find(id) != nullptr);
+      CHECK(listed(r, id));
+   }
+
+   // The functions of the registered Lexicon only, in order of
+   // construction; slices partition them.
+   auto fs = r.nodes(fundecl_cat);
+   CHECK(fs.size() == 2);
+   CHECK(fs.size() == 2 and fs[0].node_id == first[0]
+         and fs[1].node_id == own[0]);
+   int sliced = 0;
+   for (int i = 0; i < 3; ++i)
+      for (auto& f : fs.slice(i, 3)) {
+         CHECK(&f == &fs[sliced]);
+         ++sliced;
+      }
+   CHECK(sliced == fs.size());
+
+   // Every node recorded by category is alive and recorded by id.
+   int n = 0;
+   for (int c = 0; c < last_code_cat; ++c)
+      for (auto& x : r.nodes(Category_code(c))) {
+         CHECK(x.category == c);
+         CHECK(r.find(x.node_id) == &x);
+         ++n;
+      }
+   CHECK(n == r.size());
+
+   return testing::status();
+}
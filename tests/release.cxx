@@ -0,0 +1,91 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include <ipr/io>
+#include "check"
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ipr;
+
+namespace {
+   std::string
+   print(const Translation_unit& unit)
+   {
+      std::ostringstream os;
+      Printer pp { os };
+      pp << unit;
+      return os.str();
+   }
+
+   // struct <n> { int* x; };  <n>* v;
+   impl::Class*
+   build(impl::Lexicon& lex, impl::Module_unit& u, const char* n)
+   {
+      impl::Region& g = *u.global_region();
+      impl::Class* c = lex.make_class(g);
+      c->id = &lex.get_identifier(n);
+      g.declare_type(*c->id, lex.class_type())->init = c;
+      c->declare_field(lex.get_identifier("x"),
+                       lex.get_pointer(lex.int_type()));
+      g.declare_var(lex.get_identifier("v"), lex.get_pointer(*c));
+      return c;
+   }
+}
+
+int
+main()
+{
+   impl::Lexicon lex { impl::Lexicon::registered };
+   const Node_registry& r = *lex.registry();
+   impl::Module mod { lex };
+   const Type& ip = lex.get_pointer(lex.int_type());
+
+   impl::Module_unit* keep = mod.make_unit();
+   keep->storage.activate();
+   impl::Class* k = build(lex, *keep, "K");
+   keep->storage.deactivate();
+   const std::string text = print(*keep);
+
+   // A unit whose nodes, and the types made of them, are released.
+   impl::Module_unit* u = mod.make_unit();
+   u->storage.activate();
+   const Type& ipp = lex.get_pointer(ip);
+   impl::Class* c = build(lex, *u, "C");
+   const std::vector<int> ids { c->node_id, lex.get_pointer(*c).node_id };
+   u->storage.deactivate();
+   CHECK(mod.implementation_units().size() == 2);
+   mod.release_unit(*u);
+   CHECK(mod.implementation_units().size() == 1);
+
+   // Shared nodes still resolve to themselves, even those made while
+   // the unit was built; the released ones are forgotten.
+   CHECK(&lex.get_pointer(lex.int_type()) == &ip);
+   CHECK(&lex.get_pointer(ip) == &ipp);
+   CHECK(&lex.get_identifier("C") == &lex.get_identifier("C"));
+   CHECK(lex.get_pointer(*k).node_id < ids[0]);
+   CHECK(print(*keep) == text);
+   for (int id : ids)
+      CHECK(r.find(id) == nullptr);
+   const int settled = r.size();
+
+   // Types of a class made again are new nodes.
+   impl::Module_unit* w = mod.make_unit();
+   w->storage.activate();
+   const Type& p = lex.get_pointer(*build(lex, *w, "C"));
+   w->storage.deactivate();
+   CHECK(p.node_id > ids[1]);
+   CHECK(r.find(p.node_id) == &p);
+
+   // Releasing that unit too brings the registry back to its size
+   // after the first release.
+   mod.release_unit(*w);
+   CHECK(r.size() == settled);
+
+   return testing::status();
+}
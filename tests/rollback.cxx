@@ -0,0 +1,79 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include <ipr/io>
+#include "check"
+#include <sstream>
+#include <string>
+
+using namespace ipr;
+
+namespace {
+   std::string
+   print(const ipr::Translation_unit& unit)
+   {
+      std::ostringstream os;
+      Printer pp { os };
+      pp << unit;
+      return os.str();
+   }
+}
+
+int
+main()
+{
+   impl::Lexicon lex;
+   impl::Translation_unit unit { lex };
+   impl::Region& g = *unit.global_region();
+
+   // int g() = 0; int f() { g(1); }
+   impl::ref_sequence<Type> none;
+   auto& ft = lex.get_function(lex.get_product(none), lex.int_type());
+   impl::Fundecl* g_decl = g.declare_fun(lex.get_identifier("g"), ft);
+   impl::Mapping* gm = lex.make_mapping(g);
+   gm->value_type = &lex.int_type();
+   gm->body = &lex.get_literal(lex.int_type(), "0");
+   g_decl->init = gm;
+   impl::Fundecl* f = g.declare_fun(lex.get_identifier("f"), ft);
+   impl::Mapping* m = lex.make_mapping(g);
+   m->value_type = &lex.int_type();
+   impl::Block* b = lex.make_block(m->parameters, lex.void_type());
+   m->body = b;
+   f->init = m;
+   impl::Expr_list* args = lex.make_expr_list();
+   args->push_back(&lex.get_literal(lex.int_type(), "1"));
+   b->add_stmt(lex.make_expr_stmt
+               (*lex.make_call(*lex.make_id_expr(*g_decl), *args)));
+   const std::string before = print(unit);
+
+   // Statements and operands added to nodes made before a checkpoint
+   // are taken back by its rollback, with the nodes made since.
+   int d = lex.mark();
+   impl::Expr_list* more = lex.make_expr_list();
+   more->push_back(&lex.get_literal(lex.int_type(), "2"));
+   b->add_stmt(lex.make_expr_stmt
+               (*lex.make_call(*lex.make_id_expr(*g_decl), *more)));
+   args->push_back(&lex.get_literal(lex.int_type(), "3"));
+   args->push_front(&lex.get_literal(lex.int_type(), "0"));
+   CHECK(b->body().size() == 2);
+   CHECK(args->operand().size() == 3);
+   lex.rollback(d);
+   CHECK(b->body().size() == 1);
+   CHECK(args->operand().size() == 1);
+   CHECK(print(unit) == before);
+
+   // A commit keeps them.
+   d = lex.mark();
+   args->push_front(&lex.get_literal(lex.int_type(), "0"));
+   b->add_stmt(lex.make_expr_stmt(lex.get_literal(lex.int_type(), "4")));
+   lex.commit(d);
+   CHECK(b->body().size() == 2);
+   CHECK(args->operand().size() == 2);
+   CHECK(print(unit) != before);
+
+   return testing::status();
+}
@@ -0,0 +1,104 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include "check"
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace ipr;
+
+namespace {
+   bool
+   same(const impl::ref_sequence<Identifier>& s,
+        const std::deque<const Identifier*>& d)
+   {
+      if (s.size() != int(d.size()))
+         return false;
+      for (int i = 0; i < s.size(); ++i)
+         if (&s[i] != d[i])
+            return false;
+      return true;
+   }
+}
+
+int
+main()
+{
+   impl::Lexicon lex;
+   std::vector<const Identifier*> ids;
+   for (int i = 0; i < 64; ++i)
+      ids.push_back(&lex.get_identifier("x" + std::to_string(i)));
+
+   // Additions and removals at both ends and in the middle, against
+   // a deque.
+   impl::ref_sequence<Identifier> s;
+   std::deque<const Identifier*> d;
+   bool ok = true;
+   for (int i = 0; i < 5000; ++i) {
+      const Identifier* x = ids[i % ids.size()];
+      switch (i % 7) {
+      case 0: case 1: case 2:
+         s.push_front(x);
+         d.push_front(x);
+         break;
+      case 3: case 4:
+         s.push_back(x);
+         d.push_back(x);
+         break;
+      case 5:
+         s.pop_front();
+         d.pop_front();
+         break;
+      default:
+         s.erase(d.size() / 2);
+         d.erase(d.begin() + d.size() / 2);
+         break;
+      }
+      ok = ok and same(s, d);
+   }
+   CHECK(ok);
+
+   // Not in the room left at the front.
+   s.pop_front();
+   d.pop_front();
+   bool thrown = false;
+   try {
+      s[-1];
+   }
+   catch (const std::out_of_range&) {
+      thrown = true;
+   }
+   CHECK(thrown);
+
+   // A frozen sequence keeps its elements, and rejects additions.
+   s.freeze();
+   CHECK(same(s, d));
+   thrown = false;
+   try {
+      s.push_front(ids[0]);
+   }
+   catch (const std::logic_error&) {
+      thrown = true;
+   }
+   CHECK(thrown);
+
+   // An expression list built bottom up.
+   impl::Expr_list* l = lex.make_expr_list();
+   const int n = 100000;
+   auto lit = [&](int i) -> const Expr* {
+      return &lex.get_literal(lex.int_type(), ids[i % 64]->string());
+   };
+   for (int i = 0; i < n; ++i)
+      l->push_front(lit(i));
+   CHECK(l->operand().size() == n);
+   CHECK(&l->operand()[0] == lit(n - 1));
+   CHECK(&l->operand()[n - 1] == lit(0));
+
+   return testing::status();
+}
@@ -0,0 +1,48 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include "check"
+#include <string>
+#include <vector>
+
+using namespace ipr;
+
+namespace {
+   std::string
+   text(const String& s)
+   {
+      return std::string(s.begin(), s.end());
+   }
+
+   std::string
+   spelling(int k)
+   {
+      return "s" + std::to_string(k) + std::string(k % 40, 'x');
+   }
+}
+
+int
+main()
+{
+   // Strings of many pools, short and long, keep their characters.
+   impl::Lexicon lex;
+   const int n = 100000;
+   std::vector<const String*> made;
+   for (int k = 0; k < n; ++k)
+      made.push_back(&lex.get_string(spelling(k)));
+   const String& large = lex.get_string(std::string(1 << 20, 'y'));
+   int wrong = 0;
+   for (int k = 0; k < n; ++k) {
+      wrong += text(*made[k]) != spelling(k);
+      wrong += &lex.get_string(spelling(k)) != made[k];
+   }
+   CHECK(wrong == 0);
+   CHECK(large.size() == 1 << 20);
+   CHECK(text(large) == std::string(1 << 20, 'y'));
+
+   return testing::status();
+}
@@ -0,0 +1,74 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include <ipr/symbols>
+#include "check"
+#include <sstream>
+#include <string>
+
+using namespace ipr;
+
+namespace {
+   std::string
+   saved(const symbols::Index& x)
+   {
+      std::ostringstream os;
+      x.save(os);
+      return os.str();
+   }
+}
+
+int
+main()
+{
+   impl::Lexicon lex;
+   impl::Translation_unit unit { lex };
+   impl::Region& g = *unit.global_region();
+   auto& i = lex.int_type();
+
+   // namespace N { int g; struct C { int x; }; }  int a0, ..., a7;
+   // namespace N { int h; }  int z;
+   impl::Namespace* ns = lex.make_namespace(g);
+   ns->id = &lex.get_identifier("N");
+   g.declare_type(*ns->id, lex.namespace_type())->init = ns;
+   ns->declare_var(lex.get_identifier("g"), i);
+   impl::Class* c = lex.make_class(ns->body);
+   c->id = &lex.get_identifier("C");
+   ns->declare_type(*c->id, lex.class_type())->init = c;
+   c->declare_field(lex.get_identifier("x"), i);
+   for (int k = 0; k < 8; ++k)
+      g.declare_var(lex.get_identifier("a" + std::to_string(k)), i);
+   g.declare_type(*ns->id, lex.namespace_type())->init = ns;
+   ns->declare_var(lex.get_identifier("h"), i);
+   g.declare_var(lex.get_identifier("z"), i);
+
+   // The members of a reopened namespace are indexed once, whether
+   // the parts with its declarations are walked by one thread or
+   // several; the indices are the same.
+   symbols::Index one { unit, { 1 } };
+   CHECK(one.lookup("N").size() == 2);
+   CHECK(one.lookup("N::g").size() == 1);
+   CHECK(one.lookup("N::h").size() == 1);
+   CHECK(one.lookup("N::C::x").size() == 1);
+   CHECK(one.lookup("z").size() == 1);
+   CHECK(one.lookup("C").empty());
+   for (int n : { 2, 3, 4, 16 }) {
+      symbols::Index many { unit, { n } };
+      CHECK(many.size() == one.size());
+      CHECK(many.lookup("N::g").size() == 1);
+      CHECK(&many.lookup("N::C::x")[0] == &one.lookup("N::C::x")[0]);
+      CHECK(saved(many) == saved(one));
+   }
+
+   // A saved index is used in place.
+   const std::string s = saved(one);
+   symbols::Index loaded { s.data(), s.size(), unit };
+   CHECK(loaded.size() == one.size());
+   CHECK(&loaded.lookup("N::h")[0] == &one.lookup("N::h")[0]);
+
+   return testing::status();
+}
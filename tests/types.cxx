@@ -0,0 +1,65 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include <ipr/property>
+#include "check"
+#include <string>
+#include <vector>
+
+using namespace ipr;
+
+int
+main()
+{
+   impl::Lexicon lex;
+
+   // A sparse map keeps its entries across erasures of others in the
+   // same probe runs.
+   {
+      std::vector<const Node*> ids;
+      for (int i = 0; i < 1000; ++i)
+         ids.push_back(&lex.get_identifier("x" + std::to_string(i)));
+      Sparse_node_map<int> m;
+      for (int i = 0; i < 1000; ++i)
+         m[*ids[i]] = i;
+      for (int i = 0; i < 1000; i += 3)
+         CHECK(m.erase(ids[i]->node_id));
+      CHECK(not m.erase(ids[0]->node_id));
+      bool kept = true;
+      for (int i = 0; i < 1000; ++i) {
+         const int* v = m.find(*ids[i]);
+         kept = kept and (i % 3 == 0 ? v == nullptr : v != nullptr and *v == i);
+      }
+      CHECK(kept);
+      CHECK(m.size() == 1000 - 334);
+   }
+
+   // Derived types are unified, and built again after a rollback.
+   const ipr::Type& t = lex.int_type();
+   const ipr::Pointer& p = lex.get_pointer(t);
+   CHECK(&lex.get_pointer(t) == &p);
+   CHECK(&lex.get_reference(t) == &lex.get_reference(t));
+   CHECK(&lex.get_qualified(Type_qualifier::Const, t)
+         == &lex.get_qualified(Type_qualifier::Const, t));
+
+   const int d = lex.mark();
+   const ipr::Type& q = lex.get_pointer(p);
+   CHECK(&lex.get_pointer(p) == &q);
+   lex.rollback(d);
+   const ipr::Pointer& r = lex.get_pointer(p);
+   CHECK(&r.points_to() == &p);
+   CHECK(&lex.get_pointer(p) == &r);
+   CHECK(&lex.get_pointer(t) == &p);
+
+   // In a later Lexicon, types with large node_ids are linked as well.
+   impl::Lexicon later;
+   const ipr::Type& u = later.get_pointer(later.char_type());
+   CHECK(&later.get_pointer(later.char_type()) == &u);
+   CHECK(&later.get_reference(u) == &later.get_reference(u));
+
+   return testing::status();
+}
@@ -0,0 +1,38 @@
+//
+// This file is part of The Pivot framework.
+// Written by Gabriel Dos Reis.
+// See LICENSE for copyright and license notices.
+//
+
+#include <ipr/impl>
+#include "check"
+
+using namespace ipr;
+
+int
+main()
+{
+   impl::Lexicon lex;
+   const Type& i = lex.int_type();
+
+   // Unary nodes are made once per operand.
+   CHECK(&lex.cxx_linkage() == &lex.cxx_linkage());
+   CHECK(&lex.get_linkage("C") == &lex.get_linkage("C"));
+   CHECK(&lex.get_linkage("C") != &lex.cxx_linkage());
+   CHECK(&lex.get_operator("+") == &lex.get_operator("+"));
+   CHECK(&lex.get_operator("+") != &lex.get_operator("-"));
+   CHECK(&lex.get_conversion(i) == &lex.get_conversion(i));
+   CHECK(&lex.get_conversion(i) != &lex.get_conversion(lex.char_type()));
+
+   // And so are the function types with the default linkage.
+   impl::ref_sequence<Type> ps;
+   ps.push_back(&i);
+   const Product& p = lex.get_product(ps);
+   CHECK(&lex.get_function(p, i) == &lex.get_function(p, i));
+   CHECK(&lex.get_function(p, i, lex.get_linkage("C"))
+         == &lex.get_function(p, i, lex.get_linkage("C")));
+   CHECK(&lex.get_function(p, i, lex.get_linkage("C"))
+         != &lex.get_function(p, i));
+
+   return testing::status();
+}